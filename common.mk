@@ -199,4 +199,5 @@ src/app/ShijimaContextMenu.o: src/app/ShijimaContextMenu.moc
 src/app/ShijimaLicensesDialog.o: src/app/ShijimaLicensesDialog.moc
 src/app/ShimejiInspectorDialog.o: src/app/ShimejiInspectorDialog.moc
 src/app/SpeechBubbleWidget.o: src/app/SpeechBubbleWidget.moc
+src/app/SettingsStore.o: src/app/SettingsStore.moc
 -include *.d
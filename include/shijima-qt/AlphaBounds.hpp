@@ -0,0 +1,157 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include <cstddef>
+#include <cstdint>
+
+// The alpha bounds kernel reads 32-bit ARGB pixels (0xAARRGGBB in native
+// byte order) a group at a time and only falls back to per-pixel checks
+// inside a group that contains an opaque pixel. Kept free of Qt so the
+// vector paths can be checked against the scalar one on their own.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHIJIMA_ALPHA_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SHIJIMA_ALPHA_NEON 1
+#endif
+
+namespace AlphaBounds {
+
+struct ScalarGroup {
+    static constexpr int kSize = 1;
+    static bool hasOpaque(const uint32_t *pixels) {
+        return (*pixels >> 24) != 0;
+    }
+};
+
+#if defined(__AVX2__)
+struct VectorGroup {
+    static constexpr int kSize = 8;
+    static bool hasOpaque(const uint32_t *pixels) {
+        __m256i px = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(pixels));
+        __m256i alpha = _mm256_and_si256(px,
+            _mm256_set1_epi32((int)0xFF000000));
+        return !_mm256_testz_si256(alpha, alpha);
+    }
+};
+#elif defined(SHIJIMA_ALPHA_SSE2)
+struct VectorGroup {
+    static constexpr int kSize = 4;
+    static bool hasOpaque(const uint32_t *pixels) {
+        __m128i px = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(pixels));
+        __m128i alpha = _mm_and_si128(px, _mm_set1_epi32((int)0xFF000000));
+        __m128i transparent = _mm_cmpeq_epi32(alpha, _mm_setzero_si128());
+        return _mm_movemask_epi8(transparent) != 0xFFFF;
+    }
+};
+#elif defined(SHIJIMA_ALPHA_NEON)
+struct VectorGroup {
+    static constexpr int kSize = 4;
+    static bool hasOpaque(const uint32_t *pixels) {
+        uint32x4_t alpha = vandq_u32(vld1q_u32(pixels),
+            vdupq_n_u32(0xFF000000));
+        uint32x2_t folded = vorr_u32(vget_low_u32(alpha),
+            vget_high_u32(alpha));
+        return (vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) != 0;
+    }
+};
+#else
+using VectorGroup = ScalarGroup;
+#endif
+
+// Index of the first opaque pixel in [begin, end), or end if there is none
+template<typename Group = VectorGroup>
+int firstOpaque(const uint32_t *row, int begin, int end) {
+    int x = begin;
+    for (; x + Group::kSize <= end; x += Group::kSize) {
+        if (Group::hasOpaque(row + x)) {
+            break;
+        }
+    }
+    for (; x < end; ++x) {
+        if ((row[x] >> 24) != 0) {
+            return x;
+        }
+    }
+    return end;
+}
+
+// Index of the last opaque pixel in [begin, end), or begin-1 if there is none
+template<typename Group = VectorGroup>
+int lastOpaque(const uint32_t *row, int begin, int end) {
+    int x = end;
+    for (; x - Group::kSize >= begin; x -= Group::kSize) {
+        if (Group::hasOpaque(row + x - Group::kSize)) {
+            break;
+        }
+    }
+    for (--x; x >= begin; --x) {
+        if ((row[x] >> 24) != 0) {
+            return x;
+        }
+    }
+    return begin - 1;
+}
+
+struct Rect {
+    int x, y, width, height;
+};
+
+// Bounding box of the pixels with non-zero alpha in an image whose rows
+// are stride bytes apart. A fully transparent image yields
+// { width, height, 0, 0 }.
+template<typename Group = VectorGroup>
+Rect opaqueBounds(const unsigned char *bits, int width, int height,
+    std::ptrdiff_t stride)
+{
+    int startX = width, endX = 0, startY = height, endY = 0;
+    for (int y=0; y<height; ++y) {
+        auto row = reinterpret_cast<const uint32_t *>(bits + y * stride);
+        int first = firstOpaque<Group>(row, 0, width);
+        if (first == width) {
+            continue;
+        }
+        if (startY == height) {
+            startY = y;
+        }
+        endY = y + 1;
+        if (first < startX) {
+            startX = first;
+        }
+        // Only the part right of the current bound can extend it
+        int last = lastOpaque<Group>(row, first > endX ? first : endX, width);
+        if (last >= endX) {
+            endX = last + 1;
+        }
+    }
+    if (startY == height) {
+        return { width, height, 0, 0 };
+    }
+    return { startX, startY, endX - startX, endY - startY };
+}
+
+}
@@ -20,31 +20,110 @@
 
 #include <QImage>
 #include <QRect>
+#include <QRegion>
 #include <QBitmap>
 #include <QPoint>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <vector>
+#include "shijima-qt/FrameAtlas.hpp"
 
 class Asset {
 private:
+    struct ScaledVariant {
+        double scale;
+        bool mirrored;
+        QImage image;
+    };
+    struct ShapeVariant {
+        double scale;
+        bool mirrored;
+        QRegion region;
+    };
+    // Number of scaled variants kept per asset. Mascots sharing a template
+    // normally share a single scale, the rest of the slots absorb mirroring
+    // and short-lived scale changes.
+    static constexpr size_t kMaxScaledVariants = 4;
     static QRect getRectForImage(QImage const& image);
     QRect m_offset;
     QSize m_originalSize;
     QImage m_image;
-    QImage m_mirrored;
-#ifdef __linux__
-    QBitmap m_mask;
-    QBitmap m_mirroredMask;
-#endif
+    // Derived lazily, many packs provide their own right-facing frames
+    // and many mascots never turn around
+    mutable QImage m_mirrored;
+    // One bit per pixel of the trimmed frame, set where alpha is non-zero.
+    // Rows are m_hitStride words long. Mirrored lookups flip x.
+    std::vector<uint64_t> m_hitMask;
+    int m_hitStride = 0;
+    void buildHitMask();
+    void resetDerived();
+    static std::atomic<int> s_mirroredCount;
+    static std::atomic<int> s_maskCount;
+    // Only needed for window masks and overlay input shapes, built on
+    // first use. m_maskImage is only set when the mask came from the disk
+    // cache.
+    QImage m_maskImage;
+    mutable QBitmap m_mask;
+    mutable QBitmap m_mirroredMask;
+    // Most recently used shape first
+    mutable std::list<ShapeVariant> m_shapes;
+    // Set when m_image is a view into a shared template atlas
+    std::shared_ptr<const FrameAtlas> m_atlas;
+    int m_atlasSlot = -1;
+    // Most recently used variant first
+    mutable std::list<ScaledVariant> m_scaledVariants;
 public:
     QRect const& offset() const { return m_offset; }
     QSize const& originalSize() const { return m_originalSize; }
+    // The mirrored image is created on first use, request it from the
+    // GUI thread only
     QImage const& image(bool mirrored) const { 
-        return mirrored ? m_mirrored : m_image;
+        return mirrored ? mirroredImage() : m_image;
     }
-#ifdef __linux__
-    QBitmap const& mask(bool mirrored) const { 
-        return mirrored ? m_mirroredMask : m_mask;
+    QImage const& mirroredImage() const;
+    // Number of mirrored images and masks materialized so far, across
+    // all assets
+    static int mirroredCount() { return s_mirroredCount; }
+    static int maskCount() { return s_maskCount; }
+    // Whether the pixel at the given position of the trimmed frame is
+    // not fully transparent. Out of range positions are transparent.
+    bool opaqueAt(bool mirrored, int x, int y) const {
+        if (x < 0 || y < 0 || x >= m_image.width() || y >= m_image.height()) {
+            return false;
+        }
+        if (mirrored) {
+            x = m_image.width() - 1 - x;
+        }
+        return (m_hitMask[(size_t)y * m_hitStride + (x >> 6)] >> (x & 63)) & 1;
     }
-#endif
+    // Returns the frame pre-scaled for the given draw scale in
+    // premultiplied ARGB32, ready to be drawn without transformation.
+    // The reference stays valid until the next call on this asset.
+    QImage const& scaledImage(bool mirrored, double scale) const;
+    // Must be called from the GUI thread
+    QBitmap const& mask(bool mirrored) const;
+    // Window shape for the frame drawn at the given scale, relative to
+    // the top left corner of the frame. Must be called from the GUI thread.
+    QRegion const& shape(bool mirrored, double scale) const;
+    // Atlas holding the unmirrored frame, or nullptr
+    FrameAtlas const *atlas() const { return m_atlas.get(); }
+    FrameAtlas::Slot const& atlasSlot() const {
+        return m_atlas->slot(m_atlasSlot);
+    }
+    // Approximate memory held by this frame, including derived images.
+    // The pixels of atlas-backed frames are left out, the atlas is shared
+    // and counted once, see FrameAtlas::byteSize().
+    qint64 byteSize() const;
     Asset() {}
     void setImage(QImage const& image);
+    // Restores a frame that was prepared by setImage() earlier. image must
+    // already be trimmed to offset and premultiplied. The mask may be null,
+    // it is then built when first needed.
+    void setPreprocessed(QImage const& image, QRect const& offset,
+        QSize const& originalSize, QImage const& mask);
+    // Replaces the frame pixels with the given atlas slot, which must
+    // contain the same image
+    void attachToAtlas(std::shared_ptr<const FrameAtlas> atlas, int slot);
 };
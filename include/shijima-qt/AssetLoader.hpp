@@ -19,17 +19,111 @@
 // 
 
 #include "shijima-qt/Asset.hpp"
+#include "shijima-qt/FrameDiskCache.hpp"
 #include <QImage>
-#include <QMap>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 
 class AssetLoader
 {
+public:
+    struct Statistics {
+        // Frames decoded on the GUI thread because they were requested
+        // before a background preload could provide them
+        int syncDecodes;
+        // Frames prepared by preloadAssets() on the thread pool
+        int backgroundDecodes;
+        // Frames mapped from the on-disk cache instead of being decoded
+        int diskCacheHits;
+        qint64 hits;
+        qint64 misses;
+        qint64 evictions;
+        // As of the last trim()
+        qint64 residentBytes;
+        qint64 budgetBytes;
+        // Lazily derived data created so far, see Asset
+        int mirroredImages;
+        int masks;
+    };
 private:
-    QMap<QString, Asset> m_assets;
+    struct Frame {
+        Asset asset;
+        QString path;
+        bool loaded = false;
+        quint64 lastUse = 0;
+        // Frames shown by live mascots are never evicted
+        int pins = 0;
+    };
+    // All frames of one template, indexed by frame handle. A deque keeps
+    // references to frames stable while new handles are appended.
+    struct FrameTable {
+        QString imgRoot;
+        std::deque<Frame> frames;
+        QHash<QString, int> handles;
+    };
+    std::mutex m_mutex;
+    // Keyed by template id. Preload tasks keep their own reference, so
+    // a table that is unloaded while they run is simply dropped.
+    QHash<int, std::shared_ptr<FrameTable>> m_tables;
+    quint64 m_useClock = 0;
+    std::atomic<int> m_syncDecodes { 0 };
+    std::atomic<int> m_backgroundDecodes { 0 };
+    std::atomic<int> m_diskCacheHits { 0 };
+    std::atomic<qint64> m_hits { 0 };
+    std::atomic<qint64> m_misses { 0 };
+    std::atomic<qint64> m_evictions { 0 };
+    std::atomic<qint64> m_residentBytes { 0 };
+    std::atomic<qint64> m_budgetBytes { 512ll * 1024 * 1024 };
+    std::atomic<bool> m_atlasEnabled { true };
+    QElapsedTimer m_trimTimer;
+    QThreadPool m_pool;
+    FrameDiskCache m_diskCache;
     AssetLoader();
+    ~AssetLoader();
+    static QImage decodeImage(QString const& path);
+    // Fills asset from the disk cache if possible, decoding and caching
+    // the image otherwise. Returns true on a disk cache hit. Thread-safe.
+    bool prepareAsset(QString const& path, Asset &asset);
+    // Creates the table if needed, only preloadAssets() does that.
+    // Must be called with m_mutex held.
+    std::shared_ptr<FrameTable> &tableFor(int templateId,
+        QString const& imgRoot);
+    int addFrame(FrameTable &table, QString const& name);
+    bool insertFrame(FrameTable &table, int handle, Asset &&asset);
 public:
     static AssetLoader *defaultLoader();
     static void finalize();
-    Asset const& loadAsset(QString path);
-    void unloadAssets(QString root);
+    // Resolves a lowercased frame name from actions.xml to a handle that
+    // stays valid for as long as the template is loaded. Resolve once
+    // per frame change, not per frame drawn. Returns -1 for templates
+    // that are not loaded, which every other call treats as a no-op.
+    int frameHandle(int templateId, QString const& imgRoot,
+        QString const& name);
+    // The returned reference stays valid until the next trim() or
+    // unloadAssets() call. Unknown templates yield an empty asset.
+    Asset const& loadAsset(int templateId, int handle);
+    void preloadAssets(int templateId, QString const& imgRoot);
+    void unloadAssets(int templateId);
+    void pinAsset(int templateId, int handle);
+    void unpinAsset(int templateId, int handle);
+    void setBudget(qint64 bytes);
+    // Packing preloaded templates into atlases can be turned off to
+    // compare memory use, see neurolingsce_bench --no-atlas. Affects
+    // templates preloaded afterwards.
+    void setAtlasEnabled(bool enabled) { m_atlasEnabled = enabled; }
+    // Blocks until preloading and disk cache writes are done, used by
+    // the benchmark
+    void waitForBackgroundWork() { m_pool.waitForDone(); }
+    // Evicts least recently used templates that no mascot shows, and
+    // frames outside an atlas, until the resident size fits the budget.
+    // Cheap to call every tick, the actual scan runs at most once per
+    // second. Must be called from the GUI thread.
+    void trim();
+    Statistics statistics() const;
 };
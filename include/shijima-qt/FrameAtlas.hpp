@@ -0,0 +1,56 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Packs the trimmed frames of a template into a few large premultiplied
+// sheets so that a pack with hundreds of frames does not end up spread
+// over hundreds of small allocations. Mirrored frames, masks and scaled
+// variants are still allocated per frame, and only for the frames that
+// need them, see Asset.
+class FrameAtlas {
+public:
+    struct Slot {
+        uint16_t sheet;
+        uint16_t x, y;
+        uint16_t width, height;
+        QRect rect() const { return { x, y, width, height }; }
+    };
+    static constexpr int kSheetSize = 2048;
+    // Slot i of the returned atlas holds images[i]. Frames larger than a
+    // sheet get a sheet of their own.
+    static std::shared_ptr<FrameAtlas> build(QList<QImage> const& images);
+    QImage const& sheet(int index) const { return m_sheets[index]; }
+    Slot const& slot(int index) const { return m_slots[index]; }
+    int sheetCount() const { return (int)m_sheets.size(); }
+    // Memory held by all sheets
+    qint64 byteSize() const;
+    // Read-only image sharing the sheet memory of the given slot. It is
+    // only valid for as long as the atlas is alive.
+    QImage view(int index) const;
+private:
+    std::vector<QImage> m_sheets;
+    std::vector<Slot> m_slots;
+};
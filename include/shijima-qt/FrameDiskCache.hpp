@@ -0,0 +1,60 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QString>
+
+// Persistent cache of preprocessed frames. Every source PNG gets one file
+// holding the trimmed premultiplied pixels, the trim rectangle, the
+// original size and the 1-bit hit mask, laid out so that it can be mapped
+// and used in place without decoding anything.
+//
+// Entries are keyed by the source path and validated against its
+// modification time and size, so editing a mascot invalidates its frames.
+// Stale entries are only deleted by prune().
+class FrameDiskCache {
+public:
+    struct Frame {
+        QImage image;
+        QRect offset;
+        QSize originalSize;
+        // Null if the entry was written without a mask
+        QImage mask;
+    };
+    explicit FrameDiskCache(QString const& directory);
+    // Maps the entry for the given source file. The returned pixels
+    // reference the mapping and keep it alive. Returns false if there is
+    // no entry or it is stale.
+    bool load(QString const& sourcePath, Frame &frame) const;
+    // Writes the entry for the given source file, replacing any previous
+    // one. Failures are not fatal, the frame will simply be decoded again
+    // next time.
+    void store(QString const& sourcePath, Frame const& frame) const;
+    // Deletes entries whose source file is gone or has changed, then the
+    // oldest entries until the directory holds at most maxBytes.
+    void prune(qint64 maxBytes) const;
+private:
+    QString m_directory;
+    static QString absolutePath(QString const& sourcePath);
+    QString entryPath(QString const& sourcePath) const;
+};
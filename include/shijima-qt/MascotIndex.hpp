@@ -0,0 +1,60 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include <QHash>
+#include <QList>
+#include <QPoint>
+#include <QRect>
+
+class ShijimaWidget;
+
+// Uniform grid over the window rects of live mascots, in the coordinate
+// space of their windows (global coordinates, or the sandbox in windowed
+// mode). Keeps hit tests and region queries from visiting every mascot.
+class MascotIndex {
+public:
+    static constexpr int kCellSize = 256;
+    // Inserts the widget or moves it to its new rect
+    void update(ShijimaWidget *widget, QRect const& rect);
+    void remove(ShijimaWidget *widget);
+    void clear();
+    // Widgets whose rect contains the point, topmost (most recently
+    // spawned) first
+    QList<ShijimaWidget *> at(QPoint const& point) const;
+    // Widgets whose rect intersects the given rect, topmost first
+    QList<ShijimaWidget *> intersecting(QRect const& rect) const;
+    int size() const { return (int)m_rects.size(); }
+private:
+    struct CellRange {
+        int left, top, right, bottom;
+        bool operator==(CellRange const& other) const {
+            return left == other.left && top == other.top &&
+                right == other.right && bottom == other.bottom;
+        }
+    };
+    static CellRange cellsFor(QRect const& rect);
+    static quint64 cellKey(int x, int y);
+    void insertCells(ShijimaWidget *widget, CellRange const& range);
+    void removeCells(ShijimaWidget *widget, CellRange const& range);
+    static void sortTopmostFirst(QList<ShijimaWidget *> &widgets);
+    QHash<ShijimaWidget *, QRect> m_rects;
+    QHash<quint64, QList<ShijimaWidget *>> m_cells;
+};
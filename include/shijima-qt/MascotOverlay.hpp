@@ -0,0 +1,58 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include <QWidget>
+#include <QPointer>
+#include <QRegion>
+#include "shijima-qt/PlatformWidget.hpp"
+
+class QScreen;
+class QPaintEvent;
+class QMouseEvent;
+class ShijimaWidget;
+class MascotIndex;
+
+// Transparent window covering one screen that draws every mascot on it,
+// used instead of one native window per mascot when overlay rendering is
+// enabled. Input is limited to the mascots' opaque pixels with a window
+// mask, and mouse events are forwarded to the mascot under the cursor.
+class MascotOverlay : public PlatformWidget<QWidget>
+{
+public:
+    explicit MascotOverlay(QScreen *screen, MascotIndex *index,
+        QWidget *parent = nullptr);
+    QScreen *overlayScreen() const { return m_screen; }
+    // Marks a rect in global coordinates for repainting on the next flush
+    void invalidate(QRect const& globalRect);
+    // Repaints the invalidated area and updates the input shape
+    void flush();
+protected:
+    void paintEvent(QPaintEvent *) override;
+    void mousePressEvent(QMouseEvent *) override;
+    void mouseReleaseEvent(QMouseEvent *) override;
+private:
+    QScreen *m_screen;
+    MascotIndex *m_index;
+    // In local coordinates
+    QRegion m_dirty;
+    QRegion m_inputShape;
+    QPointer<ShijimaWidget> m_pressTarget;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+
+#include <QPointF>
+#include <QRect>
+#include <vector>
+
+class ShijimaWidget;
+
+// Live mascots, stored densely for the tick loop. External ids are
+// generational handles (slot in the low bits, generation above), so a
+// lookup is a bounds check and an array access, and the id of a removed
+// mascot never resolves to the mascot that reuses its slot.
+//
+// Per-mascot data read by every tick lives in arrays parallel to the
+// dense widget array. Removing a mascot moves the last one into its
+// place, so dense indices are only valid until the next removal.
+class MascotRegistry {
+public:
+    static constexpr int kSlotBits = 16;
+    static constexpr int kMaxMascots = 1 << kSlotBits;
+    // Id the next insert() hands out. Widgets are constructed with it.
+    int nextId() const;
+    // True once kMaxMascots mascots are alive. Callers check this before
+    // creating a widget, insert() throws when it is full.
+    bool full() const {
+        return m_freeSlots.empty() && (int)m_generations.size() >= kMaxMascots;
+    }
+    // Adds a widget constructed with nextId()
+    void insert(ShijimaWidget *widget);
+    // Puts a widget recreated from a registered one in its place,
+    // keeping its id and per-mascot data
+    void replace(ShijimaWidget *widget);
+    // Removes the mascot at a dense index and bumps the generation of
+    // its slot
+    void removeAt(int index);
+    void clear();
+    // Dense index of a live mascot, -1 for unknown or stale ids
+    int indexOf(int id) const;
+    ShijimaWidget *find(int id) const;
+    ShijimaWidget *at(int index) const { return m_widgets[index]; }
+    int size() const { return (int)m_widgets.size(); }
+    bool empty() const { return m_widgets.empty(); }
+    std::vector<ShijimaWidget *>::const_iterator begin() const {
+        return m_widgets.begin();
+    }
+    std::vector<ShijimaWidget *>::const_iterator end() const {
+        return m_widgets.end();
+    }
+
+    // Anchor before this tick's simulation
+    QPointF &anchorBefore(int index) { return m_anchorBefore[index]; }
+    // Window rect as of the last applyTick()
+    QRect &windowRect(int index) { return m_windowRects[index]; }
+    // Fall-through tracking: when a mascot falls 700+ pixels, it
+    // bypasses the taskbar floor and lands at the absolute screen bottom
+    bool fallTracking(int index) const { return m_fallTracking[index]; }
+    double fallStartY(int index) const { return m_fallStartY[index]; }
+    bool fallThrough(int index) const { return m_fallThrough[index]; }
+    void startFall(int index, double y);
+    void stopFall(int index) { m_fallTracking[index] = false; }
+    void setFallThrough(int index, bool fallThrough);
+private:
+    static int makeId(int slot, int generation);
+    static int slotOf(int id) { return id & (kMaxMascots - 1); }
+    static int generationOf(int id) { return id >> kSlotBits; }
+    // Indexed by slot
+    std::vector<int> m_generations;
+    std::vector<int> m_denseIndices;
+    std::vector<int> m_freeSlots;
+    // Indexed by dense index
+    std::vector<ShijimaWidget *> m_widgets;
+    std::vector<int> m_slots;
+    std::vector<QPointF> m_anchorBefore;
+    std::vector<QRect> m_windowRects;
+    std::vector<char> m_fallTracking;
+    std::vector<double> m_fallStartY;
+    std::vector<char> m_fallThrough;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+
+#include <memory>
+#include <vector>
+#include <QtGlobal>
+#include <shijima/mascot/manager.hpp>
+
+class QWidget;
+class MascotData;
+class ShijimaWidget;
+
+// Hidden desktop mascot windows that are handed out again instead of
+// creating and destroying a native window for every spawn and death.
+// Windowed mode mascots are plain child widgets and are not pooled.
+class MascotWindowPool {
+public:
+    static constexpr int kDefaultSize = 16;
+    static constexpr int kMaxSize = 256;
+    explicit MascotWindowPool(QWidget *parent): m_parent(parent) {}
+    ~MascotWindowPool();
+    // Number of idle windows to keep. Creates windows up to it right
+    // away and deletes the ones above it.
+    void setSize(int size);
+    int size() const { return m_size; }
+    int idle() const { return (int)m_idle.size(); }
+    // A desktop widget showing the given mascot
+    ShijimaWidget *acquire(MascotData *mascotData,
+        std::unique_ptr<shijima::mascot::manager> mascot, int mascotId);
+    // A desktop widget taking over the mascot of another widget
+    ShijimaWidget *acquire(ShijimaWidget &old);
+    // Takes the widget of a closed mascot, which must not be used
+    // afterwards. Deletes it if the pool is full.
+    void release(ShijimaWidget *widget);
+    // Acquires served by an idle window and by a new one
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+private:
+    ShijimaWidget *take();
+    QWidget *m_parent;
+    int m_size = 0;
+    std::vector<ShijimaWidget *> m_idle;
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+};
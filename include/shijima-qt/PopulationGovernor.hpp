@@ -0,0 +1,71 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+// Decides whether a breed request may be fulfilled now. Tracks the
+// measured simulation cost per mascot and the resident memory of the
+// process, and holds the population below the mascot cap, below the
+// point where a tick would exceed the frame budget and below the memory
+// cap. Requests that would go over are deferred by the caller and
+// retried as mascots die or ticks get cheaper.
+class PopulationGovernor {
+public:
+    enum class Decision { Allow, Defer };
+    // Off by default, the per-mascot cost varies too much between
+    // machines and mascot packs for one budget to suit everyone
+    static constexpr double kDefaultFrameBudgetMs = 0.0;
+    // Deferred breed requests kept at most, and for how long
+    static constexpr int kMaxDeferred = 32;
+    static constexpr qint64 kDeferredTimeoutMs = 30000;
+    // 0 turns a limit off
+    void setFrameBudgetMs(double budget) { m_frameBudgetMs = budget; }
+    double frameBudgetMs() const { return m_frameBudgetMs; }
+    void setMascotCap(int cap) { m_mascotCap = cap; }
+    int mascotCap() const { return m_mascotCap; }
+    void setMemoryCapBytes(qint64 cap) { m_memoryCapBytes = cap; }
+    qint64 memoryCapBytes() const { return m_memoryCapBytes; }
+    // Called after every full tick with the time spent simulating and
+    // applying mascots, without the fixed costs of the tick, and the
+    // number of mascots alive afterwards
+    void tickFinished(qint64 mascotNsecs, int mascotCount);
+    // Whether one more mascot may be added to mascotCount live ones
+    Decision admit(int mascotCount) const;
+    // Largest population all limits allow right now, -1 if unlimited
+    int currentCap(int mascotCount) const;
+    // Average simulation cost per mascot
+    double mascotCostMs() const { return m_mascotCostMs; }
+    qint64 residentBytes() const { return m_residentBytes; }
+    // Breed requests that were dropped after being deferred
+    void addDenied() { ++m_denied; }
+    quint64 denied() const { return m_denied; }
+private:
+    double m_frameBudgetMs = kDefaultFrameBudgetMs;
+    int m_mascotCap = 0;
+    qint64 m_memoryCapBytes = 0;
+    double m_mascotCostMs = 0.0;
+    bool m_measured = false;
+    qint64 m_residentBytes = -1;
+    QElapsedTimer m_residentAge;
+    quint64 m_denied = 0;
+};
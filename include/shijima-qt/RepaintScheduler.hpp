@@ -0,0 +1,47 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include <QElapsedTimer>
+
+// Paces mascot repaints to the display. Mascots only mark themselves as
+// needing a paint while they tick, and the manager issues the paints when
+// a display frame is due, so subticks that fall between two frames do not
+// paint at all.
+class RepaintScheduler {
+public:
+    void setRefreshRate(double hz);
+    // Returns true at most once per display frame
+    bool frameDue();
+    // A mascot changed again before its previous change was painted
+    void paintSkipped() { ++m_skipped; }
+    // Call once at the end of every tick
+    void tickFinished();
+    // Average number of skipped paints per tick over the last second
+    double skippedPerTick() const { return m_skippedPerTick; }
+private:
+    QElapsedTimer m_clock;
+    qint64 m_frameInterval = 16666667;
+    qint64 m_nextFrame = 0;
+    int m_skipped = 0;
+    int m_ticks = 0;
+    QElapsedTimer m_statsTimer;
+    double m_skippedPerTick = 0.0;
+};
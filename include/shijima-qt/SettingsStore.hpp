@@ -0,0 +1,73 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariant>
+
+// In-memory copy of the application settings. Everything is read from
+// disk once; value() and the typed getters never touch QSettings, so hot
+// paths such as mouse clicks can read settings freely. setValue() updates
+// the copy right away and writes changed keys back on a worker thread
+// once no other change arrived for kWriteDelayMs.
+// Only to be used from the GUI thread.
+class SettingsStore : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int kWriteDelayMs = 500;
+    static SettingsStore *defaultStore();
+    // Writes pending changes and destroys the store
+    static void finalize();
+    QVariant value(QString const& key, QVariant const& defaultValue = {}) const;
+    void setValue(QString const& key, QVariant const& value);
+    // Writes pending changes and waits for them to reach the disk
+    void sync();
+    bool speechBubbleEnabled() const { return m_speechBubbleEnabled; }
+    int speechBubbleClickCount() const { return m_speechBubbleClickCount; }
+    bool multiplicationEnabled() const { return m_multiplicationEnabled; }
+    double detachThreshold() const { return m_detachThreshold; }
+    // Frame cache budget in megabytes
+    int assetCacheBudget() const { return m_assetCacheBudget; }
+    bool overlayRendering() const { return m_overlayRendering; }
+signals:
+    void valueChanged(QString const& key, QVariant const& value);
+private:
+    SettingsStore();
+    ~SettingsStore();
+    void refresh(QString const& key);
+    void write();
+    QHash<QString, QVariant> m_values;
+    QSet<QString> m_dirty;
+    QTimer m_writeTimer;
+    // One thread, so writes reach the disk in order
+    QThreadPool m_writer;
+    bool m_speechBubbleEnabled = true;
+    int m_speechBubbleClickCount = 1;
+    bool m_multiplicationEnabled = true;
+    double m_detachThreshold = 30.0;
+    int m_assetCacheBudget = 512;
+    bool m_overlayRendering = false;
+};
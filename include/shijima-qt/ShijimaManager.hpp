@@ -22,19 +22,33 @@
 #include <shijima/mascot/manager.hpp>
 #include <shijima/mascot/factory.hpp>
 #include <vector>
+#include <QHash>
 #include <QMap>
 #include <QListWidgetItem>
 #include <QListWidget>
-#include <QSettings>
+#include <QThreadPool>
 #include <QScreen>
+#include <QTimer>
 #include "shijima-qt/PlatformWidget.hpp"
 #include "shijima-qt/MascotData.hpp"
 #include <set>
 #include <list>
+#include <deque>
+#include <type_traits>
+#include <utility>
 #include <mutex>
 #include <atomic>
 #include "Platform/ActiveWindowObserver.hpp"
 #include "shijima-qt/ShijimaWidget.hpp"
+#include "shijima-qt/MascotIndex.hpp"
+#include "shijima-qt/MascotRegistry.hpp"
+#include "shijima-qt/MascotWindowPool.hpp"
+#include "shijima-qt/PopulationGovernor.hpp"
+#include "shijima-qt/MascotOverlay.hpp"
+#include "shijima-qt/RepaintScheduler.hpp"
+#include "shijima-qt/SettingsStore.hpp"
+#include "shijima-qt/TickProfiler.hpp"
+#include "shijima-qt/TickScheduler.hpp"
 #include "shijima-qt/ShijimaHttpApi.hpp"
 #include <condition_variable>
 #include <QTranslator>
@@ -55,8 +69,15 @@ public:
     static void finalize();
     void updateEnvironment();
     void updateEnvironment(QScreen *);
+    void updateActiveWindow();
+    void invalidateScreenGeometry(QScreen *);
     QString const& mascotsPath();
+    // nullptr if MascotRegistry::kMaxMascots mascots are alive already
     ShijimaWidget *spawn(std::string const& name);
+    // New widget for a spawned or bred mascot, from the window pool
+    // unless in windowed mode
+    ShijimaWidget *createMascot(MascotData *data,
+        std::unique_ptr<shijima::mascot::manager> mascot);
     void killAll();
     void killAll(QString const& name);
     void killAllButOne(ShijimaWidget *widget);
@@ -66,10 +87,37 @@ public:
     void quitAction();
     QMap<QString, MascotData *> const& loadedMascots();
     QMap<int, MascotData *> const& loadedMascotsById();
-    std::list<ShijimaWidget *> const& mascots();
-    std::map<int, ShijimaWidget *> const& mascotsById();
+    MascotRegistry const& mascots();
+    // nullptr for unknown and stale ids
+    ShijimaWidget *mascotById(int id);
     ShijimaWidget *hitTest(QPoint const& screenPos);
+    MascotIndex &mascotIndex() { return m_mascotIndex; }
+    RepaintScheduler &repaintScheduler() { return m_repaintScheduler; }
+    TickProfiler &tickProfiler() { return m_tickProfiler; }
+    TickScheduler &tickScheduler() { return m_tickScheduler; }
+    RateCounter &timerWakeups() { return m_timerWakeups; }
+    RateCounter &geometryRequests() { return m_geometryRequests; }
+    MascotWindowPool &windowPool() { return m_windowPool; }
+    PopulationGovernor &populationGovernor() { return m_populationGovernor; }
+    int deferredBreedCount() const { return (int)m_deferredBreeds.size(); }
     void onTickSync(std::function<void(ShijimaManager *)> callback);
+    // Restarts mascot ticks after they were stopped or slowed down
+    // because nothing was happening
+    void wakeTicks();
+    // Draws mascots into one overlay per screen instead of giving each
+    // its own window. Saved in the settings.
+    bool overlayRendering() const { return m_overlayRendering; }
+    void setOverlayRendering(bool enabled);
+    // False in windowed mode, whatever overlayRendering() says
+    bool usesOverlays();
+    // Driving ticks by hand instead of from the mascot timer, used by the
+    // benchmark. Anything that wakes ticks restarts the timer, so
+    // stopTicks() has to be called again afterwards.
+    void stopTicks();
+    void tick();
+    static int maxSimulationThreads();
+    void setSimulationThreads(int threads);
+    int simulationThreads() const { return m_simulationThreads; }
     ~ShijimaManager();
 protected:
     void timerEvent(QTimerEvent *event) override;
@@ -100,11 +148,28 @@ private:
     bool windowedMode();
     QWidget *mascotParent();
     void setWindowedMode(bool windowedMode);
+    void updateOverlays();
+    void showMascot(ShijimaWidget *mascot);
+    void compositeMascots();
+    void flushPaints();
+    void scheduleTick();
+    void mascotTimerFired();
+    bool cursorNear(int index);
+    bool offScreen(int index);
+    int nextSimulationLane();
+    void simulateMascots();
+    void updateMascotsAfterSimulation();
+    using BreedRequest = std::decay_t<decltype(
+        std::declval<shijima::mascot::manager &>().state->breed_request)>;
+    void breed(BreedRequest const& request,
+        std::shared_ptr<shijima::mascot::environment> env);
+    // Fulfills deferred breed requests while the governor allows it
+    void drainDeferredBreeds();
+    void dropDeferredBreeds(QString const& name);
     void screenAdded(QScreen *);
     void screenRemoved(QScreen *);
     std::set<std::string> import(QString const& path) noexcept;
     void importWithDialog(QList<QString> const& paths);
-    void tick();
     void retranslateUi();
     void switchLanguage(const QString &langCode);
     void updateStatusBar();
@@ -112,11 +177,17 @@ private:
     QColor m_sandboxBackground;
     QAction *m_windowedModeAction;
     QWidget *m_sandboxWidget;
-    QSettings m_settings;
+    SettingsStore &m_settings;
     Platform::ActiveWindow m_previousWindow;
     Platform::ActiveWindow m_currentWindow;
     Platform::ActiveWindowObserver m_windowObserver;
-    int m_mascotTimer = -1;
+    // Single-shot, re-armed by scheduleTick() for every subtick deadline
+    QTimer m_mascotTimer;
+    // Stopped: nothing to simulate or ticks are driven by hand, and
+    // wakeTicks() arms the timer again. Closed: the manager is shutting
+    // down and ticks never resume.
+    enum class TickTimerState { Stopped, Armed, Closed };
+    TickTimerState m_mascotTimerState = TickTimerState::Stopped;
     bool m_allowClose = false;
     bool m_firstShow = true;
     bool m_wasVisible = false;
@@ -129,10 +200,64 @@ private:
     QSet<QString> m_listItemsToRefresh;
     QMap<QScreen *, std::shared_ptr<shijima::mascot::environment>> m_env;
     QMap<shijima::mascot::environment *, QScreen *> m_reverseEnv;
-    shijima::mascot::factory m_factory;
+    // Unscaled environment borders of every screen, rebuilt only after
+    // the screen (or the sandbox window) reports a geometry change
+    struct ScreenGeometry {
+        decltype(shijima::mascot::environment::screen) screen;
+        decltype(shijima::mascot::environment::floor) floor;
+        decltype(shijima::mascot::environment::work_area) work_area;
+        decltype(shijima::mascot::environment::ceiling) ceiling;
+        QPoint origin;
+        bool valid = false;
+    };
+    QMap<QScreen *, ScreenGeometry> m_screenGeometry;
+    // Active window edge without deltas, and the value handed to the
+    // environments this tick. Rebuilt only when the observed window changes.
+    decltype(shijima::mascot::environment::active_ie) m_activeWindowArea { -50, -50, -50, -50 };
+    decltype(shijima::mascot::environment::active_ie) m_activeIE { -50, -50, -50, -50 };
+    // One factory per simulation lane, as many as the largest thread
+    // count used so far. Every factory has all templates registered, the
+    // first one is used where the lane does not matter.
+    std::vector<std::unique_ptr<shijima::mascot::factory>> m_factories;
+    int m_nextLane = 0;
+    int m_simulationThreads = 1;
+    QThreadPool m_simulationPool;
+    // Per-tick work lists, kept around to reuse their storage. Tick
+    // entries are dense indices into m_mascots.
+    std::vector<int> m_tickEntries;
+    std::vector<std::vector<ShijimaWidget *>> m_laneMascots;
+    // Per lane copies of the environments, keyed by the live environment.
+    // Only used with more than one simulation thread.
+    std::vector<QHash<shijima::mascot::environment *,
+        std::shared_ptr<shijima::mascot::environment>>> m_laneEnvironments;
+    std::vector<ShijimaWidget *> m_fallThroughMascots;
     QString m_importOnShowPath;
-    std::list<ShijimaWidget *> m_mascots;
-    std::map<int, ShijimaWidget *> m_mascotsById;
+    MascotRegistry m_mascots;
+    MascotWindowPool m_windowPool;
+    // Breed requests the governor held back, oldest first
+    struct DeferredBreed {
+        BreedRequest request;
+        std::shared_ptr<shijima::mascot::environment> env;
+        QElapsedTimer age;
+    };
+    PopulationGovernor m_populationGovernor;
+    std::deque<DeferredBreed> m_deferredBreeds;
+    MascotIndex m_mascotIndex;
+    RepaintScheduler m_repaintScheduler;
+    TickProfiler m_tickProfiler;
+    TickScheduler m_tickScheduler;
+    // Timer events, which drop while all mascots sleep and stop while
+    // there are no mascots
+    RateCounter m_timerWakeups;
+    int m_subtickPhase = 0;
+    bool m_allAsleep = false;
+    bool m_environmentChanged = false;
+    // Native window moves/resizes issued by flushPaints()
+    RateCounter m_geometryRequests;
+    // Draw all mascots of a screen into a single overlay window instead
+    // of giving each one its own window. Not used in windowed mode.
+    bool m_overlayRendering = false;
+    QMap<QScreen *, MascotOverlay *> m_overlays;
     QString m_mascotsPath;
     QListWidget m_listWidget;
     ShijimaHttpApi m_httpApi;
@@ -145,6 +270,7 @@ private:
     QTranslator *m_qtTranslator;
     QString m_currentLanguage;
     QLabel *m_statusLabel = nullptr;
+    QTimer m_statusTimer;
     QWidget *m_homePage = nullptr;
     QWidget *m_settingsPage = nullptr;
     QString m_settingsKey;
@@ -24,6 +24,7 @@
 #include <QElapsedTimer>
 #include <QTimer>
 #include "shijima-qt/Asset.hpp"
+#include "shijima-qt/RateCounter.hpp"
 #include "shijima-qt/SoundEffectManager.hpp"
 #include <shijima/mascot/manager.hpp>
 #include <shijima/mascot/environment.hpp>
@@ -34,6 +35,7 @@ class QPushButton;
 class QPaintEvent;
 class QMouseEvent;
 class QCloseEvent;
+class QPainter;
 class ShijimaContextMenu;
 class SpeechBubbleWidget;
 class ShimejiInspectorDialog;
@@ -43,16 +45,38 @@ class ShijimaWidget : public PlatformWidget<QWidget>
 public:
     friend class ShijimaContextMenu;
     friend class ShijimaManager;
+    friend class MascotWindowPool;
     explicit ShijimaWidget(MascotData *mascotData,
         std::unique_ptr<shijima::mascot::manager> mascot,
         int mascotId, bool windowedMode, QWidget *parent = nullptr);
     explicit ShijimaWidget(ShijimaWidget &old, bool windowedMode,
         QWidget *parent = nullptr);
+    // A window without a mascot, see MascotWindowPool. It has to be
+    // recycled before it is shown.
+    explicit ShijimaWidget(bool windowedMode, QWidget *parent);
+    // Drops the mascot and everything tied to it but keeps the window
+    void retire();
+    // Makes a retired (or new) window show another mascot
+    void recycle(MascotData *mascotData,
+        std::unique_ptr<shijima::mascot::manager> mascot, int mascotId);
+    // Takes over the mascot of another widget, like the copy constructor
+    void recycle(ShijimaWidget &old);
+    bool windowedMode() const { return m_windowedMode; }
     void tick();
+    // tick() in two halves. simulate() only steps the mascot state and
+    // may run on a worker thread, applyTick() does the window work on
+    // the GUI thread afterwards.
+    void simulate();
+    void applyTick();
     bool pointInside(QPoint const& point);
     int mascotId() { return m_mascotId; }
+    // Mascot windows are stacked in this order
+    quint64 spawnOrder() const { return m_spawnOrder; }
     void showInspector();
     void markForDeletion() { m_markedForDeletion = true; }
+    // Makes a mascot that the manager let sleep step every subtick
+    // again. Called after changing a mascot from outside its tick.
+    void wake() { m_stillTicks = 0; }
     bool inspectorVisible();
     bool paused() const { return m_paused || m_contextMenuVisible; }
     shijima::mascot::manager &mascot() {
@@ -71,11 +95,43 @@ public:
         return m_data->name();
     }
     ~ShijimaWidget();
-    bool isFallThroughMode() const { return m_fallThroughMode; }
+    // Composited mascots are never shown as windows of their own, a
+    // MascotOverlay draws them and forwards input to them instead
+    void setComposited(bool composited);
+    bool composited() const { return m_composited; }
+    // Set once the mascot was closed, whether or not it was ever shown
+    bool closed() const { return m_closed; }
+    // Where the mascot window is, or would be if it is composited. The
+    // native window follows once applyGeometry() is called.
+    QRect const& windowRect() const { return m_windowRect; }
+    // Global position of a point relative to the window. Composited
+    // mascots are mapped through windowRect(), their hidden native window
+    // may be stale or may never have been created.
+    QPoint mapToScreen(QPoint const& pos) const;
+    // Moves and resizes the native window with a single request if the
+    // geometry changed since the last call. Returns true if a request
+    // was made.
+    bool applyGeometry();
+    // Draws the active frame for a window whose top left corner is at
+    // windowOrigin
+    void paintFrame(QPainter &painter, QPoint const& windowOrigin);
+    // Mouse handling shared by the window and the overlays. Positions
+    // are relative to the window. pressAt returns false if there was no
+    // mascot at the position.
+    bool pressAt(QPoint const& pos, Qt::MouseButton button);
+    void releaseAt(QPoint const& pos, Qt::MouseButton button);
+    // Opaque pixels of the active frame in global coordinates, built from
+    // the cached frame shape. Empty while the mascot is not visible.
+    QRegion inputShape();
+#ifdef __linux__
+    // Window shape changes sent to the window system by all mascots
+    static RateCounter &shapeUpdateCounter();
+#endif
 protected:
     void paintEvent(QPaintEvent *) override;
     void mousePressEvent(QMouseEvent *) override;
     void mouseReleaseEvent(QMouseEvent *) override;
+    void closeEvent(QCloseEvent *) override;
 private:
     void setDragTarget(ShijimaWidget *target);
     bool isMirroredRender() const;
@@ -85,6 +141,7 @@ private:
     bool updateOffsets();
     void showSpeechBubble();
     void handleClick();
+    void releaseMascot();
 #ifdef __linux__
     QRegion m_windowMask;
 #endif
@@ -93,6 +150,12 @@ private:
     ShimejiInspectorDialog *m_inspector;
     SoundEffectManager m_sounds;
     Asset const& getActiveAsset();
+    // Frame handle for m_frameName, resolved again only when the active
+    // frame changes. The template id is kept alongside so that the pin
+    // can be released even after the mascot data is gone.
+    std::string m_frameName;
+    int m_frameTemplate = -1;
+    int m_frameHandle = -1;
     ShijimaWidget *m_dragTarget = nullptr;
     ShijimaWidget **m_dragTargetPt = nullptr;
     std::unique_ptr<shijima::mascot::manager> m_mascot;
@@ -102,16 +165,33 @@ private:
     QPoint m_drawOrigin;
     int m_windowHeight;
     int m_windowWidth;
-    bool m_visible;
+    bool m_visible = false;
     bool m_contextMenuVisible = false;
     bool m_paused = false;
     bool m_markedForDeletion = false;
+    bool m_composited = false;
+    bool m_closed = false;
+    // Changed since the last display frame, see RepaintScheduler
+    bool m_paintPending = false;
+    QRect m_windowRect;
+    bool m_geometryPending = false;
+    // Composited mode: rect the overlays last drew this mascot in
+    QRect m_compositedRect;
     int m_mascotId;
-    // Fall-through tracking: when mascot falls 700+ pixels, it bypasses
-    // the taskbar floor and lands at the absolute screen bottom.
-    bool m_fallTracking = false;
-    double m_fallStartY = 0.0;
-    bool m_fallThroughMode = false;
+    quint64 m_spawnOrder;
+    // Set by simulate() for applyTick()
+    bool m_simulated = false;
+    std::string m_previousFrameName;
+    double m_previousAnchorX = 0.0;
+    double m_previousAnchorY = 0.0;
+    // Activity level. The manager lets mascots that have been still for
+    // long enough sleep and step them several times at once.
+    int m_stillTicks = 0;
+    int m_simulationSteps = 1;
+    bool m_stopOnMotion = false;
+    // Mascots in the same lane share a factory and are never simulated
+    // concurrently, see ShijimaManager::simulateMascots()
+    int m_simulationLane = 0;
     // Speech bubble click tracking
     SpeechBubbleWidget *m_speechBubble = nullptr;
     QPoint m_lastPressGlobalPos;
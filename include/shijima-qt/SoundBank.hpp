@@ -0,0 +1,149 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class QThread;
+class QObject;
+class QAudioSink;
+class SoundMixerDevice;
+
+// Process-wide store of decoded sound effects and the mixer that plays
+// them. Every file is decoded once, keyed by its absolute path, straight
+// into the output format of the audio device, and all voices are mixed
+// into one audio stream on a thread of its own. At most voiceLimit()
+// voices play at once. Starting another one stops the voice with the
+// lowest priority, the oldest one among equals; if all playing voices
+// have a higher priority the new one is not started.
+//
+// Voices are started, stopped and queried from the GUI thread. The mixer
+// only picks up changes when it can do so without waiting for a lock.
+class SoundBank {
+    friend class SoundMixerDevice;
+public:
+    static constexpr int kDefaultVoiceLimit = 8;
+    static constexpr int kMaxVoices = 64;
+    struct Statistics {
+        int samples;
+        qint64 decodedBytes;
+        int activeVoices;
+        qint64 stolenVoices;
+        // Share of one core spent mixing, over the last second
+        double mixerLoad;
+    };
+    static SoundBank *defaultBank();
+    static void finalize();
+    // Decodes every WAV file in the directory on a worker thread
+    void preload(QString const& directory);
+    // Starts playing a file and returns its voice, or 0 if the file can
+    // not be decoded or all voices are busy with more important sounds.
+    // Files that were not preloaded are decoded on the calling thread.
+    quint64 play(QString const& path, int priority = 0);
+    // False once the voice finished, was stopped or was stolen
+    bool playing(quint64 voice) const;
+    void stop(quint64 voice);
+    void setVoiceLimit(int limit);
+    int voiceLimit() const { return m_voiceLimit; }
+    Statistics statistics();
+private:
+    // Interleaved frames in the mixer format
+    struct Sample {
+        std::vector<float> data;
+    };
+    // A voice is identified by its slot and a serial number. The serial
+    // changes every time the slot is reused, so stale ids are harmless.
+    struct Command {
+        int slot;
+        quint64 serial;
+        // nullptr to stop the voice
+        std::shared_ptr<const Sample> sample;
+    };
+    struct Voice {
+        std::shared_ptr<const Sample> sample;
+        size_t position = 0;
+        quint64 serial = 0;
+    };
+    SoundBank();
+    ~SoundBank();
+    std::shared_ptr<const Sample> decode(QString const& path);
+    std::shared_ptr<const Sample> sample(QString const& path);
+    void startOutput();
+    // Queues a command for the mixer and resumes the output if the idle
+    // timer suspended it
+    void post(Command const& command);
+    // Called by the mixer device on the audio thread
+    void mix(float *out, qint64 frames);
+
+    // Decoded samples, shared by the GUI thread and the preloader
+    std::mutex m_sampleMutex;
+    QHash<QString, std::shared_ptr<const Sample>> m_samples;
+    QSet<QString> m_failed;
+    std::atomic<int> m_sampleCount { 0 };
+    std::atomic<qint64> m_decodedBytes { 0 };
+
+    // Serial of the voice in each slot, 0 for a free slot. Set by the GUI
+    // thread when a voice starts or stops, cleared by the mixer when a
+    // voice finishes.
+    std::atomic<quint64> m_slotSerials[kMaxVoices] {};
+    // GUI thread only
+    int m_slotPriorities[kMaxVoices] {};
+    int m_voiceLimit = kDefaultVoiceLimit;
+    quint64 m_nextSerial = 1;
+    qint64 m_stolenVoices = 0;
+
+    // Commands for the mixer. The mixer only try-locks this. m_suspended
+    // is also guarded by it so that suspending and posting a command can
+    // not race.
+    std::mutex m_commandMutex;
+    std::vector<Command> m_commands;
+    bool m_suspended = false;
+
+    // Audio thread only
+    Voice m_voices[kMaxVoices];
+    std::vector<Command> m_mixerCommands;
+
+    // Mixer output format, chosen once from the default output device.
+    // m_sampleFormat holds a QAudioFormat::SampleFormat.
+    int m_sampleRate = 0;
+    int m_channels = 0;
+    int m_sampleFormat = 0;
+    bool m_outputStarted = false;
+    QThreadPool m_pool;
+    QThread *m_thread = nullptr;
+    QObject *m_context = nullptr;
+    QAudioSink *m_sink = nullptr;
+    SoundMixerDevice *m_device = nullptr;
+
+    // Mixer load, m_mixNsecs is added to by the audio thread
+    std::atomic<qint64> m_mixNsecs { 0 };
+    qint64 m_lastMixNsecs = 0;
+    QElapsedTimer m_loadTimer;
+    double m_mixerLoad = 0.0;
+};
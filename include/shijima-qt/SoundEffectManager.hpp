@@ -18,20 +18,26 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 // 
 
-#include <QMap>
+#include <QHash>
 #include <QString>
 
-class QSoundEffect;
-
+// Plays one effect at a time for a mascot. Samples and voices belong to
+// the shared SoundBank; this only resolves names against searchPaths.
 class SoundEffectManager {
 public:
+    // Voice priorities, see SoundBank::play(). Sounds of the mascot the
+    // user is dragging keep playing when a crowd runs out of voices.
+    static constexpr int kAmbientPriority = 0;
+    static constexpr int kInteractionPriority = 1;
     SoundEffectManager() {}
     QList<QString> searchPaths;
-    void play(QString const& name);
+    void play(QString const& name, int priority = kAmbientPriority);
     bool playing() const;
     void stop();
+    // Stops and forgets resolved names, for when the search paths change
+    void clear();
     ~SoundEffectManager();
 private:
-    QMap<QString, QSoundEffect *> m_loadedEffects;
-    QSoundEffect *m_activeEffect = nullptr;
+    QHash<QString, QString> m_paths;
+    quint64 m_voice = 0;
 };
\ No newline at end of file
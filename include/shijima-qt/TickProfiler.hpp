@@ -0,0 +1,93 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include <QElapsedTimer>
+#include <array>
+#include <vector>
+
+// Measures wall time spent in the phases of a mascot tick. Times are
+// summed per tick and the last kWindowTicks ticks are kept for
+// percentiles. Disabled by default, a disabled Scope costs one branch.
+// Not thread-safe, only used on the GUI thread.
+class TickProfiler {
+public:
+    enum Phase {
+        Tick,            // ShijimaManager::tick as a whole
+        Callbacks,       // onTickSync callbacks
+        Environment,     // ShijimaManager::updateEnvironment
+        WindowObserver,  // active window queries (DBus on Linux)
+        Simulate,        // mascot::manager::tick of all mascots
+        Serial,          // fall tracking, screen changes and breeding
+        Breeding,        // breed requests, part of Serial
+        Apply,           // ShijimaWidget::applyTick of all mascots
+        Offsets,         // ShijimaWidget::updateOffsets, part of Apply
+        Sounds,          // sound changes, part of Apply
+        Flush,           // display frame flush and window system flush
+        Paint,           // paintEvent of mascots and overlays
+        PhaseCount
+    };
+    static constexpr int kWindowTicks = 1024;
+
+    class Scope {
+    public:
+        Scope(TickProfiler &profiler, Phase phase);
+        ~Scope();
+        Scope(Scope const&) = delete;
+        Scope &operator=(Scope const&) = delete;
+    private:
+        TickProfiler &m_profiler;
+        Phase m_phase;
+        QElapsedTimer m_timer;
+    };
+
+    // Per-tick times in microseconds over the rolling window
+    struct PhaseStatistics {
+        int ticks = 0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    static char const *phaseName(Phase phase);
+    void setEnabled(bool enabled);
+    bool enabled() const { return m_enabled; }
+    void reset();
+    // Ticks completed since the last reset. A tick ends when its Tick
+    // scope ends.
+    qint64 ticks() const { return m_ticks; }
+    // Total nanoseconds spent in a phase since the last reset
+    qint64 totalNsecs(Phase phase) const { return m_total[phase]; }
+    qint64 samples(Phase phase) const { return m_samples[phase]; }
+    PhaseStatistics statistics(Phase phase) const;
+private:
+    void record(Phase phase, qint64 nsecs);
+    void finishTick();
+    bool m_enabled = false;
+    qint64 m_ticks = 0;
+    std::array<qint64, PhaseCount> m_total {};
+    std::array<qint64, PhaseCount> m_samples {};
+    std::array<qint64, PhaseCount> m_current {};
+    // kWindowTicks entries per phase, phase-major
+    std::vector<qint64> m_history;
+    int m_historyPos = 0;
+    int m_historyCount = 0;
+};
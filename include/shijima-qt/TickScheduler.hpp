@@ -0,0 +1,66 @@
+#pragma once
+
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include <QElapsedTimer>
+#include "shijima-qt/RateCounter.hpp"
+
+// Fixed-timestep clock for the mascot simulation. A simulation tick is
+// 40 ms and is split into a configurable number of subticks. Deadlines
+// advance by whole subticks, so late timer events are made up for
+// instead of slowing the mascots down. After a long stall at most one
+// tick worth of subticks is caught up and the rest is dropped.
+class TickScheduler {
+public:
+    static constexpr qint64 kTickNsecs = 40000000;
+    static constexpr int kDefaultSubtickCount = 4;
+    static constexpr int kMaxSubtickCount = 10;
+    void setSubtickCount(int count);
+    int subtickCount() const { return m_subtickCount; }
+    // Number of subticks to run now
+    int subticksDue();
+    // Milliseconds until the next subtick is due, rounded up
+    int msUntilNextSubtick() const;
+    // Moves the next deadline ahead by count subticks that the caller
+    // has nothing to do in. They are neither run nor counted as dropped.
+    void skipSubticks(int count);
+    // Makes the next subtick due now, for resuming after the timer was
+    // stopped on purpose. Nothing is caught up or dropped.
+    void restart();
+    // Average and worst lateness of subticks over the last second
+    double jitterMs() const { return m_jitterMs; }
+    double maxJitterMs() const { return m_maxJitterMs; }
+    double droppedPerSecond() { return m_dropped.rate(); }
+    qint64 droppedTotal() const { return m_droppedTotal; }
+private:
+    void recordLateness(qint64 nsecs);
+    QElapsedTimer m_clock;
+    int m_subtickCount = kDefaultSubtickCount;
+    qint64 m_interval = kTickNsecs / kDefaultSubtickCount;
+    qint64 m_nextSubtick = 0;
+    RateCounter m_dropped;
+    qint64 m_droppedTotal = 0;
+    QElapsedTimer m_statsTimer;
+    qint64 m_latenessSum = 0;
+    qint64 m_latenessMax = 0;
+    int m_latenessCount = 0;
+    double m_jitterMs = 0.0;
+    double m_maxJitterMs = 0.0;
+};
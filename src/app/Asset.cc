@@ -17,54 +17,190 @@
 // 
 
 #include "shijima-qt/Asset.hpp"
+#include "shijima-qt/AlphaBounds.hpp"
+#include <QPainter>
+#include <cstdint>
 
 QRect Asset::getRectForImage(QImage const& image) {
-    int startX=0, endX=image.width(), startY=0, endY=image.height();
-    int x, y;
+    int width = image.width(), height = image.height();
+    QImage argb = image;
+    if (argb.format() != QImage::Format_ARGB32 &&
+        argb.format() != QImage::Format_ARGB32_Premultiplied)
+    {
+        argb = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    auto rect = AlphaBounds::opaqueBounds(argb.constBits(), width, height,
+        argb.bytesPerLine());
+    return { rect.x, rect.y, rect.width, rect.height };
+}
+
+std::atomic<int> Asset::s_mirroredCount { 0 };
+std::atomic<int> Asset::s_maskCount { 0 };
 
-    for (x=0; x<endX; ++x) {
-        for (y=0; y<endY; ++y) {
-            if (image.pixelColor(x, y).alpha() > 0) break;
+void Asset::buildHitMask() {
+    int width = m_image.width(), height = m_image.height();
+    m_hitStride = (width + 63) / 64;
+    m_hitMask.assign((size_t)m_hitStride * height, 0);
+    for (int y=0; y<height; ++y) {
+        auto row = reinterpret_cast<const uint32_t *>(m_image.constScanLine(y));
+        uint64_t *bits = &m_hitMask[(size_t)y * m_hitStride];
+        // Skip transparent runs a group at a time, they make up most of
+        // a typical frame even after trimming
+        int x = AlphaBounds::firstOpaque(row, 0, width);
+        while (x < width) {
+            if ((row[x] >> 24) != 0) {
+                bits[x >> 6] |= 1ull << (x & 63);
+                ++x;
+            }
+            else {
+                x = AlphaBounds::firstOpaque(row, x, width);
+            }
         }
-        if (y != endY) break;
     }
-    startX = x;
+}
 
-    for (y=0; y<endY; ++y) {
-        for (x=startX; x<endX; ++x) {
-            if (image.pixelColor(x, y).alpha() > 0) break;
-        }
-        if (x != endX) break;
+void Asset::resetDerived() {
+    m_mirrored = {};
+    m_scaledVariants.clear();
+    m_atlas = nullptr;
+    m_atlasSlot = -1;
+    m_maskImage = {};
+    m_mask = {};
+    m_mirroredMask = {};
+    m_shapes.clear();
+}
+
+void Asset::setImage(QImage const& image) {
+    m_originalSize = image.size();
+    auto rect = getRectForImage(image);
+    m_offset = rect;
+    m_image = image.copy(rect)
+        .convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    resetDerived();
+    buildHitMask();
+}
+
+void Asset::setPreprocessed(QImage const& image, QRect const& offset,
+    QSize const& originalSize, QImage const& mask)
+{
+    m_originalSize = originalSize;
+    m_offset = offset;
+    m_image = image;
+    resetDerived();
+    buildHitMask();
+    m_maskImage = mask;
+}
+
+QImage const& Asset::mirroredImage() const {
+    if (m_mirrored.isNull() && !m_image.isNull()) {
+        // Copies only this frame, also when m_image is an atlas view
+        m_mirrored = m_image.mirrored(true, false);
+        ++s_mirroredCount;
     }
-    startY = y;
+    return m_mirrored;
+}
 
-    for (x=endX-1; x>startX; --x) {
-        for (y=startY; y<endY; ++y) {
-            if (image.pixelColor(x, y).alpha() > 0) break;
-        }
-        if (y != endY) break;
+void Asset::attachToAtlas(std::shared_ptr<const FrameAtlas> atlas, int slot) {
+    m_image = atlas->view(slot);
+    m_atlas = atlas;
+    m_atlasSlot = slot;
+}
+
+qint64 Asset::byteSize() const {
+    qint64 size = m_atlas != nullptr ? 0 : m_image.sizeInBytes();
+    size += m_mirrored.sizeInBytes();
+    size += (qint64)m_hitMask.size() * sizeof(uint64_t);
+    // One bit per pixel for the mask image and each bitmap
+    qint64 maskBytes = ((m_image.width() + 31) / 32) * 4
+        * (qint64)m_image.height();
+    size += m_maskImage.sizeInBytes();
+    if (!m_mask.isNull()) {
+        size += maskBytes;
     }
-    endX = x+1;
+    if (!m_mirroredMask.isNull()) {
+        size += maskBytes;
+    }
+    for (auto &shape : m_shapes) {
+        size += shape.region.rectCount() * (qint64)sizeof(QRect);
+    }
+    for (auto &variant : m_scaledVariants) {
+        size += variant.image.sizeInBytes();
+    }
+    return size;
+}
 
-    for (y=endY-1; y>startY; --y) {
-        for (x=startX; x<endX; ++x) {
-            if (image.pixelColor(x, y).alpha() > 0) break;
+QBitmap const& Asset::mask(bool mirrored) const {
+    QBitmap &mask = mirrored ? m_mirroredMask : m_mask;
+    if (mask.isNull() && !m_image.isNull()) {
+        QImage maskImage = m_maskImage.isNull() ? m_image.createAlphaMask()
+            : m_maskImage;
+        if (mirrored) {
+            maskImage = maskImage.mirrored(true, false);
         }
-        if (x != endX) break;
+        mask = QBitmap::fromImage(maskImage);
+        ++s_maskCount;
     }
-    endY = y+1;
+    return mask;
+}
 
-    return { startX, startY, endX - startX, endY - startY };
+QRegion const& Asset::shape(bool mirrored, double scale) const {
+    for (auto iter = m_shapes.begin(); iter != m_shapes.end(); ++iter) {
+        if (iter->mirrored == mirrored && iter->scale == scale) {
+            if (iter != m_shapes.begin()) {
+                m_shapes.splice(m_shapes.begin(), m_shapes, iter);
+            }
+            return m_shapes.front().region;
+        }
+    }
+    QSize scaledSize = m_image.size() / scale;
+    QRegion region;
+    if (!scaledSize.isEmpty()) {
+        region = QRegion { QBitmap::fromPixmap(mask(mirrored)
+            .scaled(scaledSize)) };
+    }
+    m_shapes.push_front({ scale, mirrored, region });
+    if (m_shapes.size() > kMaxScaledVariants) {
+        m_shapes.pop_back();
+    }
+    return m_shapes.front().region;
 }
 
-void Asset::setImage(QImage const& image) {
-    m_originalSize = image.size();
-    auto rect = getRectForImage(image);
-    m_offset = rect;
-    m_image = image.copy(rect);
-    m_mirrored = m_image.mirrored(true, false);
-#ifdef __linux__
-    m_mask = QBitmap::fromImage(m_image.createAlphaMask());
-    m_mirroredMask = QBitmap::fromImage(m_mirrored.createAlphaMask());
-#endif
+QImage const& Asset::scaledImage(bool mirrored, double scale) const {
+    if (scale == 1.0) {
+        return image(mirrored);
+    }
+    for (auto iter = m_scaledVariants.begin(); iter != m_scaledVariants.end();
+        ++iter)
+    {
+        if (iter->mirrored == mirrored && iter->scale == scale) {
+            if (iter != m_scaledVariants.begin()) {
+                m_scaledVariants.splice(m_scaledVariants.begin(),
+                    m_scaledVariants, iter);
+            }
+            return m_scaledVariants.front().image;
+        }
+    }
+    // Same filtering as paintEvent used to apply on every paint, so cached
+    // frames look exactly like before: area averaging for high shrink
+    // ratios, bilinear sampling otherwise.
+    auto &source = image(mirrored);
+    QSize size = source.size() / scale;
+    QImage scaled;
+    if (scale >= 4.0) {
+        scaled = source.scaled(size, Qt::IgnoreAspectRatio,
+            Qt::SmoothTransformation)
+            .convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    else {
+        scaled = QImage { size, QImage::Format_ARGB32_Premultiplied };
+        scaled.fill(Qt::transparent);
+        QPainter painter { &scaled };
+        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+        painter.drawImage(QRect { { 0, 0 }, size }, source);
+    }
+    m_scaledVariants.push_front({ scale, mirrored, scaled });
+    if (m_scaledVariants.size() > kMaxScaledVariants) {
+        m_scaledVariants.pop_back();
+    }
+    return m_scaledVariants.front().image;
 }
@@ -19,10 +19,32 @@
 #include "shijima-qt/AssetLoader.hpp"
 #include "shijima-qt/Asset.hpp"
 #include "shijima-qt/DefaultMascot.hpp"
+#include <QCoreApplication>
 #include <QDir>
-#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Upper bound for the frame cache directory, enforced once per start
+static constexpr qint64 kDiskCacheBytes = 256ll * 1024 * 1024;
 
-AssetLoader::AssetLoader() {}
+AssetLoader::AssetLoader(): m_diskCache(QStandardPaths::writableLocation(
+    QStandardPaths::AppLocalDataLocation) + "/framecache")
+{
+    // Pruning reads every entry header, keep it off the startup path
+    m_pool.start([this]() {
+        m_diskCache.prune(kDiskCacheBytes);
+    });
+}
+
+AssetLoader::~AssetLoader() {
+    m_pool.clear();
+    m_pool.waitForDone();
+}
 
 static AssetLoader *m_defaultLoader = nullptr;
 
@@ -40,33 +62,366 @@ void AssetLoader::finalize() {
     }
 }
 
-Asset const& AssetLoader::loadAsset(QString path) {
-    path = QDir::cleanPath(path);
-    if (!m_assets.contains(path)) {
-        Asset &asset = m_assets[path];
-        QImage image;
-        if (path.startsWith("@")) {
-            auto filename = path.sliced(path.lastIndexOf('/') + 1)
-                .toStdString();
-            if (defaultMascot.count(filename) == 1) {
-                auto &file = defaultMascot.at(filename);
-                image.loadFromData((const uchar *)file.first,
-                    (int)file.second);
+QImage AssetLoader::decodeImage(QString const& path) {
+    QImage image;
+    if (path.startsWith("@")) {
+        auto filename = path.sliced(path.lastIndexOf('/') + 1)
+            .toStdString();
+        if (defaultMascot.count(filename) == 1) {
+            auto &file = defaultMascot.at(filename);
+            image.loadFromData((const uchar *)file.first,
+                (int)file.second);
+        }
+    }
+    else {
+        image.load(path);
+    }
+    return image;
+}
+
+bool AssetLoader::prepareAsset(QString const& path, Asset &asset) {
+    // Built-in frames are compiled into the binary, there is no file to
+    // validate a cache entry against
+    if (path.startsWith("@")) {
+        asset.setImage(decodeImage(path));
+        return false;
+    }
+    FrameDiskCache::Frame frame;
+    if (m_diskCache.load(path, frame)) {
+        asset.setPreprocessed(frame.image, frame.offset, frame.originalSize,
+            frame.mask);
+        ++m_diskCacheHits;
+        return true;
+    }
+    asset.setImage(decodeImage(path));
+    frame.image = asset.image(false);
+    frame.offset = asset.offset();
+    frame.originalSize = asset.originalSize();
+    // Writing the entry is not needed to use the frame, keep it off the
+    // GUI thread when this is a synchronous miss
+    m_pool.start([this, path, frame]() {
+        m_diskCache.store(path, frame);
+    });
+    return false;
+}
+
+std::shared_ptr<AssetLoader::FrameTable> &AssetLoader::tableFor(
+    int templateId, QString const& imgRoot)
+{
+    auto &table = m_tables[templateId];
+    if (table == nullptr) {
+        table = std::make_shared<FrameTable>();
+        table->imgRoot = QDir::cleanPath(imgRoot);
+    }
+    return table;
+}
+
+int AssetLoader::addFrame(FrameTable &table, QString const& name) {
+    // Names in actions.xml may start with a slash and are relative to
+    // the image root either way
+    auto key = QDir::cleanPath(name);
+    while (key.startsWith('/')) {
+        key = key.sliced(1);
+    }
+    auto iter = table.handles.find(key);
+    if (iter != table.handles.end()) {
+        return *iter;
+    }
+    int handle = (int)table.frames.size();
+    table.frames.emplace_back();
+    table.frames.back().path = table.imgRoot + "/" + key;
+    table.handles.insert(key, handle);
+    return handle;
+}
+
+bool AssetLoader::insertFrame(FrameTable &table, int handle,
+    Asset &&asset)
+{
+    std::lock_guard<std::mutex> lock { m_mutex };
+    auto &frame = table.frames[handle];
+    if (frame.loaded) {
+        return false;
+    }
+    frame.asset = std::move(asset);
+    frame.loaded = true;
+    frame.lastUse = m_useClock;
+    return true;
+}
+
+int AssetLoader::frameHandle(int templateId, QString const& imgRoot,
+    QString const& name)
+{
+    std::lock_guard<std::mutex> lock { m_mutex };
+    auto iter = m_tables.find(templateId);
+    if (iter == m_tables.end()) {
+        // Unloaded, or never preloaded
+        return -1;
+    }
+    return addFrame(**iter, name);
+}
+
+Asset const& AssetLoader::loadAsset(int templateId, int handle) {
+    static const Asset empty;
+    std::shared_ptr<FrameTable> table;
+    QString path;
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        auto iter = m_tables.find(templateId);
+        if (iter == m_tables.end() || handle < 0 ||
+            handle >= (int)(*iter)->frames.size())
+        {
+            return empty;
+        }
+        table = *iter;
+        auto &frame = table->frames[handle];
+        if (frame.loaded) {
+            frame.lastUse = ++m_useClock;
+            ++m_hits;
+            return frame.asset;
+        }
+        path = frame.path;
+    }
+    ++m_misses;
+    // Not preloaded yet, decode synchronously. If a preload task
+    // finishes first, its copy is kept and this one is dropped.
+    Asset asset;
+    prepareAsset(path, asset);
+    if (insertFrame(*table, handle, std::move(asset))) {
+        ++m_syncDecodes;
+    }
+    std::lock_guard<std::mutex> lock { m_mutex };
+    auto &frame = table->frames[handle];
+    frame.lastUse = ++m_useClock;
+    return frame.asset;
+}
+
+void AssetLoader::preloadAssets(int templateId, QString const& imgRoot) {
+    // Frames are requested with lowercased names (see
+    // ShijimaWidget::getActiveAsset), so they are keyed the same way here
+    QList<std::pair<QString, QString>> paths;
+    auto root = QDir::cleanPath(imgRoot);
+    if (root.startsWith("@")) {
+        for (auto &pair : defaultMascot) {
+            auto name = QString::fromStdString(pair.first);
+            if (name.endsWith(".png")) {
+                paths.append({ name, root + "/" + name });
             }
         }
-        else {
-            image.load(path);
+    }
+    else {
+        QDir rootDir { root };
+        QDirIterator iter { root, { "*.png" }, QDir::Files,
+            QDirIterator::Subdirectories };
+        while (iter.hasNext()) {
+            auto file = iter.next();
+            paths.append({ rootDir.relativeFilePath(file).toLower(), file });
+        }
+    }
+    // The table exists even without frames, so that frameHandle() can
+    // tell a loaded template from an unloaded one
+    std::shared_ptr<FrameTable> table;
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        table = tableFor(templateId, root);
+    }
+    if (paths.isEmpty()) {
+        return;
+    }
+    // Frames are decoded in parallel. The last task to finish packs the
+    // whole template into an atlas and publishes all frames at once.
+    struct Batch {
+        std::shared_ptr<FrameTable> table;
+        std::vector<int> handles;
+        std::vector<Asset> assets;
+        std::atomic<int> remaining;
+        std::atomic<int> fromDisk { 0 };
+        QElapsedTimer timer;
+    };
+    auto batch = std::make_shared<Batch>();
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        batch->table = table;
+        for (auto &entry : paths) {
+            int handle = addFrame(*batch->table, entry.first);
+            // Frames are looked up by their lowercased name, but decoded
+            // from the file with its original case
+            batch->table->frames[handle].path = entry.second;
+            batch->handles.push_back(handle);
         }
-        asset.setImage(image);
     }
-    return m_assets[path];
+    batch->assets.resize(paths.size());
+    batch->remaining = (int)paths.size();
+    batch->timer.start();
+    for (qsizetype i=0; i<paths.size(); ++i) {
+        QString file = paths[i].second;
+        m_pool.start([this, batch, i, file, root]() {
+            if (prepareAsset(file, batch->assets[i])) {
+                ++batch->fromDisk;
+            }
+            if (--batch->remaining != 0) {
+                return;
+            }
+            std::shared_ptr<FrameAtlas> atlas;
+            if (m_atlasEnabled) {
+                QList<QImage> images;
+                for (auto &asset : batch->assets) {
+                    images.append(asset.image(false));
+                }
+                atlas = FrameAtlas::build(images);
+            }
+            for (int j=0; j<(int)batch->assets.size(); ++j) {
+                if (atlas != nullptr) {
+                    batch->assets[j].attachToAtlas(atlas, j);
+                }
+                if (insertFrame(*batch->table, batch->handles[j],
+                    std::move(batch->assets[j])))
+                {
+                    ++m_backgroundDecodes;
+                }
+            }
+            batch->assets.clear();
+            // Printed from the GUI thread, where the rest of the logging
+            // happens, so concurrent batches cannot interleave their lines
+            auto message = QString { "Preloaded %1 frames for %2 into %3 "
+                "atlas sheet(s) in %4 ms (%5 from disk cache)" }
+                .arg(batch->handles.size()).arg(root)
+                .arg(atlas != nullptr ? atlas->sheetCount() : 0)
+                .arg(batch->timer.elapsed())
+                .arg(batch->fromDisk.load()).toStdString();
+            if (auto app = QCoreApplication::instance()) {
+                QMetaObject::invokeMethod(app, [message]() {
+                    std::cout << message << std::endl;
+                }, Qt::QueuedConnection);
+            }
+        });
+    }
+}
+
+void AssetLoader::unloadAssets(int templateId) {
+    std::lock_guard<std::mutex> lock { m_mutex };
+    m_tables.remove(templateId);
+}
+
+void AssetLoader::pinAsset(int templateId, int handle) {
+    std::lock_guard<std::mutex> lock { m_mutex };
+    auto iter = m_tables.find(templateId);
+    if (iter != m_tables.end() && handle >= 0 &&
+        handle < (int)(*iter)->frames.size())
+    {
+        ++(*iter)->frames[handle].pins;
+    }
+}
+
+void AssetLoader::unpinAsset(int templateId, int handle) {
+    std::lock_guard<std::mutex> lock { m_mutex };
+    auto iter = m_tables.find(templateId);
+    if (iter != m_tables.end() && handle >= 0 &&
+        handle < (int)(*iter)->frames.size())
+    {
+        auto &frame = (*iter)->frames[handle];
+        frame.pins = std::max(0, frame.pins - 1);
+    }
+}
+
+void AssetLoader::setBudget(qint64 bytes) {
+    m_budgetBytes = bytes;
+    m_trimTimer.invalidate();
 }
 
-void AssetLoader::unloadAssets(QString root) {
-    root = QDir::cleanPath(root);
-    for (auto &path : m_assets.keys()) {
-        if (path.startsWith(root)) {
-            m_assets.remove(path);
+void AssetLoader::trim() {
+    if (m_trimTimer.isValid() && m_trimTimer.elapsed() < 1000) {
+        return;
+    }
+    m_trimTimer.start();
+    std::lock_guard<std::mutex> lock { m_mutex };
+    // Frames in an atlas only give their memory back once every frame of
+    // the atlas is gone, and a frame decoded again after its eviction
+    // would be a second copy next to the atlas. So a template without
+    // pinned frames is evicted as a whole, and from templates that are in
+    // use only frames outside an atlas are evicted.
+    struct Candidate {
+        quint64 lastUse;
+        qint64 bytes;
+        FrameTable *table;
+        // nullptr to evict every frame of the table
+        Frame *frame;
+    };
+    std::vector<Candidate> candidates;
+    qint64 resident = 0;
+    for (auto &table : m_tables) {
+        qint64 tableBytes = 0;
+        quint64 tableLastUse = 0;
+        bool pinned = false;
+        bool loaded = false;
+        std::vector<FrameAtlas const *> atlases;
+        for (auto &frame : table->frames) {
+            if (!frame.loaded) {
+                continue;
+            }
+            loaded = true;
+            qint64 bytes = frame.asset.byteSize();
+            auto atlas = frame.asset.atlas();
+            if (atlas != nullptr && std::find(atlases.begin(),
+                atlases.end(), atlas) == atlases.end())
+            {
+                atlases.push_back(atlas);
+                tableBytes += atlas->byteSize();
+            }
+            tableBytes += bytes;
+            tableLastUse = std::max(tableLastUse, frame.lastUse);
+            pinned = pinned || frame.pins != 0;
+        }
+        resident += tableBytes;
+        if (!loaded) {
+            continue;
+        }
+        if (!pinned) {
+            candidates.push_back({ tableLastUse, tableBytes, table.get(),
+                nullptr });
+            continue;
+        }
+        for (auto &frame : table->frames) {
+            if (frame.loaded && frame.pins == 0 &&
+                frame.asset.atlas() == nullptr)
+            {
+                candidates.push_back({ frame.lastUse, frame.asset.byteSize(),
+                    table.get(), &frame });
+            }
+        }
+    }
+    qint64 budget = m_budgetBytes;
+    if (resident > budget) {
+        std::sort(candidates.begin(), candidates.end(),
+            [](Candidate const& a, Candidate const& b) {
+                return a.lastUse < b.lastUse;
+            });
+        for (auto &candidate : candidates) {
+            if (resident <= budget) {
+                break;
+            }
+            if (candidate.frame != nullptr) {
+                candidate.frame->asset = {};
+                candidate.frame->loaded = false;
+                ++m_evictions;
+            }
+            else {
+                for (auto &frame : candidate.table->frames) {
+                    if (frame.loaded) {
+                        frame.asset = {};
+                        frame.loaded = false;
+                        ++m_evictions;
+                    }
+                }
+            }
+            resident -= candidate.bytes;
         }
     }
+    m_residentBytes = resident;
+}
+
+AssetLoader::Statistics AssetLoader::statistics() const {
+    return { m_syncDecodes.load(), m_backgroundDecodes.load(),
+        m_diskCacheHits.load(), m_hits.load(), m_misses.load(),
+        m_evictions.load(), m_residentBytes.load(), m_budgetBytes.load(),
+        Asset::mirroredCount(), Asset::maskCount() };
 }
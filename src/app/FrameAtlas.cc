@@ -0,0 +1,119 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/FrameAtlas.hpp"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+std::shared_ptr<FrameAtlas> FrameAtlas::build(QList<QImage> const& images) {
+    auto atlas = std::make_shared<FrameAtlas>();
+    atlas->m_slots.resize(images.size(), { 0, 0, 0, 0, 0 });
+
+    // Shelf packing, tallest frames first
+    std::vector<int> order(images.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&images](int a, int b) {
+        return images[a].height() > images[b].height();
+    });
+    std::vector<QSize> sheetSizes;
+    int current = -1;
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (int index : order) {
+        int width = images[index].width();
+        int height = images[index].height();
+        if (width <= 0 || height <= 0) {
+            continue;
+        }
+        auto &slot = atlas->m_slots[index];
+        slot.width = (uint16_t)width;
+        slot.height = (uint16_t)height;
+        if (width > kSheetSize || height > kSheetSize) {
+            // A sheet of its own, the shelves of the current sheet go on
+            slot.sheet = (uint16_t)sheetSizes.size();
+            slot.x = slot.y = 0;
+            sheetSizes.push_back({ width, height });
+            continue;
+        }
+        bool newSheet = current == -1;
+        if (!newSheet && shelfX > 0 && shelfX + width > kSheetSize) {
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = 0;
+        }
+        if (!newSheet && shelfY > 0 && shelfY + height > kSheetSize) {
+            newSheet = true;
+        }
+        if (newSheet) {
+            current = (int)sheetSizes.size();
+            sheetSizes.push_back({ 0, 0 });
+            shelfX = shelfY = shelfHeight = 0;
+        }
+        slot.sheet = (uint16_t)current;
+        slot.x = (uint16_t)shelfX;
+        slot.y = (uint16_t)shelfY;
+        shelfX += width;
+        shelfHeight = std::max(shelfHeight, height);
+        auto &sheetSize = sheetSizes[current];
+        sheetSize.setWidth(std::max(sheetSize.width(), shelfX));
+        sheetSize.setHeight(std::max(sheetSize.height(), shelfY + height));
+    }
+
+    // Allocate each sheet once at its final size and copy the frames in
+    for (auto &size : sheetSizes) {
+        QImage sheet { size, QImage::Format_ARGB32_Premultiplied };
+        sheet.fill(Qt::transparent);
+        atlas->m_sheets.push_back(sheet);
+    }
+    for (qsizetype i=0; i<images.size(); ++i) {
+        auto &slot = atlas->m_slots[i];
+        if (slot.width == 0) {
+            continue;
+        }
+        QImage frame = images[i];
+        if (frame.format() != QImage::Format_ARGB32_Premultiplied) {
+            frame = frame.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        }
+        auto &sheet = atlas->m_sheets[slot.sheet];
+        for (int y=0; y<slot.height; ++y) {
+            memcpy(sheet.scanLine(slot.y + y) + slot.x * 4,
+                frame.constScanLine(y), (size_t)slot.width * 4);
+        }
+    }
+    return atlas;
+}
+
+QImage FrameAtlas::view(int index) const {
+    auto &slot = m_slots[index];
+    if (slot.width == 0) {
+        return {};
+    }
+    auto &sheet = m_sheets[slot.sheet];
+    return QImage { sheet.constBits() + slot.y * sheet.bytesPerLine()
+        + slot.x * 4, slot.width, slot.height, sheet.bytesPerLine(),
+        QImage::Format_ARGB32_Premultiplied };
+}
+
+qint64 FrameAtlas::byteSize() const {
+    qint64 size = 0;
+    for (auto &sheet : m_sheets) {
+        size += sheet.sizeInBytes();
+    }
+    return size;
+}
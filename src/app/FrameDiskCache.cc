@@ -0,0 +1,355 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/FrameDiskCache.hpp"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Entries are only ever read back on the machine that wrote them, so
+// everything is stored in native byte order
+struct EntryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t maskFormat;
+    int64_t sourceModified;
+    int64_t sourceSize;
+    int32_t offsetX, offsetY;
+    int32_t width, height;
+    int32_t originalWidth, originalHeight;
+    uint32_t imageStride;
+    // Zero if there is no mask
+    uint32_t maskStride;
+    uint64_t imageOffset;
+    uint64_t maskOffset;
+    // Absolute source path in UTF-8, used to prune entries whose source
+    // is gone
+    uint64_t pathOffset;
+    uint64_t pathSize;
+};
+
+static_assert(std::is_trivially_copyable<EntryHeader>::value,
+    "EntryHeader is written to disk as is");
+
+constexpr char kMagic[8] = { 'N', 'L', 'F', 'R', 'A', 'M', 'E', 0 };
+constexpr uint32_t kVersion = 2;
+// Pixel data is aligned so that the mapped scanlines can be handed to
+// QImage and the SIMD paths without copying
+constexpr uint64_t kDataAlignment = 16;
+
+uint64_t alignUp(uint64_t value) {
+    return (value + kDataAlignment - 1) & ~(kDataAlignment - 1);
+}
+
+// True if [offset, offset + size) lies after the header and within the
+// file, without overflowing
+bool fitsInFile(uint64_t offset, uint64_t size, uint64_t fileSize) {
+    return offset >= sizeof(EntryHeader) && offset <= fileSize &&
+        size <= fileSize - offset;
+}
+
+// Read-only mapping of a whole entry. On POSIX the mapping outlives the
+// file descriptor, so the file is closed as soon as it is mapped and a
+// cached frame costs no descriptor. QFile unmaps on close, so elsewhere
+// the file has to stay open for as long as the mapping is used.
+class Mapping {
+public:
+    ~Mapping() {
+#ifdef Q_OS_UNIX
+        if (m_data != nullptr) {
+            munmap(const_cast<uchar *>(m_data), m_size);
+        }
+#endif
+    }
+    bool map(QString const& path) {
+#ifdef Q_OS_UNIX
+        int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void *data = mmap(nullptr, (size_t)info.st_size, PROT_READ,
+            MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        m_data = static_cast<const uchar *>(data);
+        m_size = (size_t)info.st_size;
+#else
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::ReadOnly) || m_file.size() <= 0) {
+            return false;
+        }
+        m_data = m_file.map(0, m_file.size());
+        m_size = (size_t)m_file.size();
+#endif
+        return m_data != nullptr;
+    }
+    const uchar *data() const { return m_data; }
+    uint64_t size() const { return m_size; }
+private:
+    const uchar *m_data = nullptr;
+    size_t m_size = 0;
+#ifndef Q_OS_UNIX
+    QFile m_file;
+#endif
+};
+
+// Each image created over the mapping holds one reference to it
+void releaseMapping(void *info) {
+    delete static_cast<std::shared_ptr<Mapping> *>(info);
+}
+
+QImage imageOverMapping(std::shared_ptr<Mapping> const& mapping,
+    const uchar *data, int width, int height, qsizetype stride,
+    QImage::Format format)
+{
+    return QImage { data, width, height, stride, format, releaseMapping,
+        new std::shared_ptr<Mapping>(mapping) };
+}
+
+}
+
+FrameDiskCache::FrameDiskCache(QString const& directory):
+    m_directory(directory) {}
+
+QString FrameDiskCache::absolutePath(QString const& sourcePath) {
+    return QFileInfo { sourcePath }.absoluteFilePath();
+}
+
+QString FrameDiskCache::entryPath(QString const& sourcePath) const {
+    auto absolute = absolutePath(sourcePath);
+    auto hash = QCryptographicHash::hash(absolute.toUtf8(),
+        QCryptographicHash::Sha1).toHex();
+    return m_directory + "/" + QString::fromLatin1(hash) + ".frame";
+}
+
+bool FrameDiskCache::load(QString const& sourcePath, Frame &frame) const {
+    QFileInfo source { sourcePath };
+    if (!source.exists()) {
+        return false;
+    }
+    auto mapping = std::make_shared<Mapping>();
+    if (!mapping->map(entryPath(sourcePath))) {
+        return false;
+    }
+    auto fileSize = mapping->size();
+    if (fileSize < sizeof(EntryHeader)) {
+        return false;
+    }
+    const uchar *data = mapping->data();
+    EntryHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion ||
+        header.sourceModified != source.lastModified().toMSecsSinceEpoch() ||
+        header.sourceSize != source.size() ||
+        header.width < 0 || header.height < 0)
+    {
+        return false;
+    }
+    // The header is trusted no further than the file it came from, a
+    // truncated or corrupted entry must not let QImage read past the
+    // mapping
+    uint64_t rows = (uint64_t)header.height;
+    uint64_t width = (uint64_t)header.width;
+    if (header.imageStride % 4 != 0 || header.imageStride < width * 4 ||
+        !fitsInFile(header.imageOffset, rows * header.imageStride, fileSize))
+    {
+        return false;
+    }
+    if (header.maskStride != 0 &&
+        ((header.maskFormat != (uint32_t)QImage::Format_Mono &&
+        header.maskFormat != (uint32_t)QImage::Format_MonoLSB) ||
+        header.maskStride < (width + 7) / 8 ||
+        !fitsInFile(header.maskOffset, rows * header.maskStride, fileSize)))
+    {
+        return false;
+    }
+    frame.offset = { header.offsetX, header.offsetY, header.width,
+        header.height };
+    frame.originalSize = { header.originalWidth, header.originalHeight };
+    if (header.width == 0 || header.height == 0) {
+        // Fully transparent frame
+        frame.image = {};
+        frame.mask = {};
+        return true;
+    }
+    frame.image = imageOverMapping(mapping, data + header.imageOffset,
+        header.width, header.height, header.imageStride,
+        QImage::Format_ARGB32_Premultiplied);
+    if (header.maskStride != 0) {
+        // Masks are tiny, copying them lets the mapping go away once the
+        // pixels have been moved into an atlas
+        frame.mask = QImage { data + header.maskOffset, header.width,
+            header.height, header.maskStride,
+            (QImage::Format)header.maskFormat }.copy();
+    }
+    else {
+        frame.mask = {};
+    }
+    return true;
+}
+
+void FrameDiskCache::store(QString const& sourcePath,
+    Frame const& frame) const
+{
+    QFileInfo source { sourcePath };
+    if (!source.exists() || !QDir{}.mkpath(m_directory)) {
+        return;
+    }
+    QImage image = frame.image;
+    if (!image.isNull() &&
+        image.format() != QImage::Format_ARGB32_Premultiplied)
+    {
+        image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    bool hasMask = !image.isNull() && !frame.mask.isNull() &&
+        frame.mask.size() == image.size();
+
+    EntryHeader header {};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.maskFormat = hasMask ? (uint32_t)frame.mask.format() : 0;
+    header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    header.sourceSize = source.size();
+    header.offsetX = frame.offset.x();
+    header.offsetY = frame.offset.y();
+    header.width = image.isNull() ? 0 : image.width();
+    header.height = image.isNull() ? 0 : image.height();
+    header.originalWidth = frame.originalSize.width();
+    header.originalHeight = frame.originalSize.height();
+    header.imageStride = image.isNull() ? 0 : (uint32_t)image.bytesPerLine();
+    header.maskStride = hasMask ? (uint32_t)frame.mask.bytesPerLine() : 0;
+    auto path = absolutePath(sourcePath).toUtf8();
+    header.pathOffset = sizeof(header);
+    header.pathSize = (uint64_t)path.size();
+    header.imageOffset = alignUp(header.pathOffset + header.pathSize);
+    header.maskOffset = alignUp(header.imageOffset +
+        (uint64_t)header.height * header.imageStride);
+
+    QSaveFile file { entryPath(sourcePath) };
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    auto pad = [&file](uint64_t offset) {
+        static const char zeros[kDataAlignment] = {};
+        auto current = (uint64_t)file.pos();
+        if (offset > current) {
+            file.write(zeros, (qint64)(offset - current));
+        }
+    };
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(path);
+    pad(header.imageOffset);
+    for (int y=0; y<header.height; ++y) {
+        file.write(reinterpret_cast<const char *>(image.constScanLine(y)),
+            header.imageStride);
+    }
+    if (hasMask) {
+        pad(header.maskOffset);
+        for (int y=0; y<header.height; ++y) {
+            file.write(reinterpret_cast<const char *>(
+                frame.mask.constScanLine(y)), header.maskStride);
+        }
+    }
+    file.commit();
+}
+
+void FrameDiskCache::prune(qint64 maxBytes) const {
+    struct Entry {
+        QString path;
+        qint64 size;
+        QDateTime modified;
+    };
+    std::vector<Entry> entries;
+    qint64 total = 0;
+    QDir dir { m_directory };
+    auto infos = dir.entryInfoList({ "*.frame" }, QDir::Files);
+    for (auto &info : infos) {
+        QFile file { info.absoluteFilePath() };
+        EntryHeader header;
+        bool valid = file.open(QIODevice::ReadOnly) &&
+            file.read(reinterpret_cast<char *>(&header), sizeof(header)) ==
+                sizeof(header) &&
+            memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+            header.version == kVersion &&
+            fitsInFile(header.pathOffset, header.pathSize,
+                (uint64_t)info.size()) &&
+            file.seek((qint64)header.pathOffset);
+        if (valid) {
+            // Same checks as load(), an entry that can never be used
+            // again only takes up space
+            QFileInfo source { QString::fromUtf8(
+                file.read((qint64)header.pathSize)) };
+            valid = source.exists() &&
+                header.sourceModified ==
+                    source.lastModified().toMSecsSinceEpoch() &&
+                header.sourceSize == source.size();
+        }
+        file.close();
+        if (!valid) {
+            QFile::remove(info.absoluteFilePath());
+            continue;
+        }
+        entries.push_back({ info.absoluteFilePath(), info.size(),
+            info.lastModified() });
+        total += info.size();
+    }
+    if (total <= maxBytes) {
+        return;
+    }
+    // Loading does not touch entries, so this drops the ones written
+    // first. Frames of a mascot that is still in use are simply written
+    // again the next time they are decoded.
+    std::sort(entries.begin(), entries.end(),
+        [](Entry const& a, Entry const& b) {
+            return a.modified < b.modified;
+        });
+    for (auto &entry : entries) {
+        if (total <= maxBytes) {
+            break;
+        }
+        if (QFile::remove(entry.path)) {
+            total -= entry.size;
+        }
+    }
+}
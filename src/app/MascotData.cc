@@ -101,7 +101,7 @@ QString const &MascotData::imgRoot() const {
 }
 
 void MascotData::unloadCache() const {
-    AssetLoader::defaultLoader()->unloadAssets(m_path);
+    AssetLoader::defaultLoader()->unloadAssets(m_id);
 }
 
 bool MascotData::deletable() const {
@@ -0,0 +1,165 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/MascotIndex.hpp"
+#include "shijima-qt/ShijimaWidget.hpp"
+#include <QSet>
+#include <algorithm>
+
+// Rounds towards negative infinity, screens left of or above the primary
+// screen have negative coordinates
+static int cellIndex(int coordinate) {
+    return coordinate >= 0 ? coordinate / MascotIndex::kCellSize
+        : -((-coordinate - 1) / MascotIndex::kCellSize) - 1;
+}
+
+MascotIndex::CellRange MascotIndex::cellsFor(QRect const& rect) {
+    return { cellIndex(rect.left()), cellIndex(rect.top()),
+        cellIndex(rect.right()), cellIndex(rect.bottom()) };
+}
+
+quint64 MascotIndex::cellKey(int x, int y) {
+    return ((quint64)(quint32)x << 32) | (quint32)y;
+}
+
+void MascotIndex::insertCells(ShijimaWidget *widget,
+    CellRange const& range)
+{
+    for (int y=range.top; y<=range.bottom; ++y) {
+        for (int x=range.left; x<=range.right; ++x) {
+            m_cells[cellKey(x, y)].append(widget);
+        }
+    }
+}
+
+void MascotIndex::removeCells(ShijimaWidget *widget,
+    CellRange const& range)
+{
+    for (int y=range.top; y<=range.bottom; ++y) {
+        for (int x=range.left; x<=range.right; ++x) {
+            auto iter = m_cells.find(cellKey(x, y));
+            if (iter == m_cells.end()) {
+                continue;
+            }
+            iter->removeOne(widget);
+            if (iter->isEmpty()) {
+                m_cells.erase(iter);
+            }
+        }
+    }
+}
+
+void MascotIndex::update(ShijimaWidget *widget, QRect const& rect) {
+    auto iter = m_rects.find(widget);
+    if (iter != m_rects.end()) {
+        if (*iter == rect) {
+            return;
+        }
+        auto oldRange = cellsFor(*iter);
+        auto newRange = cellsFor(rect);
+        *iter = rect;
+        // Most moves stay within the same cells
+        if (oldRange == newRange) {
+            return;
+        }
+        removeCells(widget, oldRange);
+        insertCells(widget, newRange);
+    }
+    else {
+        m_rects.insert(widget, rect);
+        insertCells(widget, cellsFor(rect));
+    }
+}
+
+void MascotIndex::remove(ShijimaWidget *widget) {
+    auto iter = m_rects.find(widget);
+    if (iter == m_rects.end()) {
+        return;
+    }
+    removeCells(widget, cellsFor(*iter));
+    m_rects.erase(iter);
+}
+
+void MascotIndex::clear() {
+    m_rects.clear();
+    m_cells.clear();
+}
+
+void MascotIndex::sortTopmostFirst(QList<ShijimaWidget *> &widgets) {
+    // Mascot windows are stacked in the order they were spawned
+    std::sort(widgets.begin(), widgets.end(),
+        [](ShijimaWidget *a, ShijimaWidget *b) {
+            return a->spawnOrder() > b->spawnOrder();
+        });
+}
+
+QList<ShijimaWidget *> MascotIndex::at(QPoint const& point) const {
+    QList<ShijimaWidget *> result;
+    auto iter = m_cells.find(cellKey(cellIndex(point.x()),
+        cellIndex(point.y())));
+    if (iter == m_cells.end()) {
+        return result;
+    }
+    for (auto widget : *iter) {
+        if (m_rects[widget].contains(point)) {
+            result.append(widget);
+        }
+    }
+    sortTopmostFirst(result);
+    return result;
+}
+
+QList<ShijimaWidget *> MascotIndex::intersecting(QRect const& rect) const {
+    QList<ShijimaWidget *> result;
+    if (!rect.isValid()) {
+        return result;
+    }
+    auto range = cellsFor(rect);
+    qint64 cellCount = (qint64)(range.right - range.left + 1)
+        * (range.bottom - range.top + 1);
+    if (cellCount > (qint64)m_cells.size()) {
+        // Larger than the populated area, checking every rect is cheaper
+        for (auto iter = m_rects.cbegin(); iter != m_rects.cend(); ++iter) {
+            if (iter->intersects(rect)) {
+                result.append(iter.key());
+            }
+        }
+        sortTopmostFirst(result);
+        return result;
+    }
+    QSet<ShijimaWidget *> seen;
+    for (int y=range.top; y<=range.bottom; ++y) {
+        for (int x=range.left; x<=range.right; ++x) {
+            auto iter = m_cells.find(cellKey(x, y));
+            if (iter == m_cells.end()) {
+                continue;
+            }
+            for (auto widget : *iter) {
+                if (!seen.contains(widget) &&
+                    m_rects[widget].intersects(rect))
+                {
+                    seen.insert(widget);
+                    result.append(widget);
+                }
+            }
+        }
+    }
+    sortTopmostFirst(result);
+    return result;
+}
@@ -0,0 +1,145 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/MascotOverlay.hpp"
+#include "shijima-qt/MascotIndex.hpp"
+#include "shijima-qt/ShijimaWidget.hpp"
+#include "shijima-qt/ShijimaManager.hpp"
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScreen>
+#include <algorithm>
+
+MascotOverlay::MascotOverlay(QScreen *screen, MascotIndex *index,
+    QWidget *parent):
+#if defined(__APPLE__)
+    PlatformWidget(nullptr, PlatformWidget::ShowOnAllDesktops),
+#else
+    PlatformWidget(parent, PlatformWidget::ShowOnAllDesktops),
+#endif
+    m_screen(screen), m_index(index)
+{
+    setAttribute(Qt::WA_TranslucentBackground);
+    setAttribute(Qt::WA_NoSystemBackground);
+    setAttribute(Qt::WA_ShowWithoutActivating);
+    setAttribute(Qt::WA_MacShowFocusRect, false);
+    Qt::WindowFlags flags = Qt::WindowStaysOnTopHint | Qt::FramelessWindowHint
+        | Qt::WindowDoesNotAcceptFocus | Qt::NoDropShadowWindowHint
+        | Qt::WindowOverridesSystemGestures;
+    #if defined(__APPLE__)
+    flags |= Qt::Window;
+    #else
+    flags |= Qt::Tool;
+    #endif
+    setWindowFlags(flags);
+    setGeometry(screen->geometry());
+    connect(screen, &QScreen::geometryChanged, this, [this](QRect const& rect){
+        setGeometry(rect);
+        m_dirty = rect.translated(-rect.topLeft());
+        flush();
+    });
+    // An empty mask would remove the mask altogether and make the whole
+    // screen swallow input
+    m_inputShape = QRect { 0, 0, 1, 1 };
+    setMask(m_inputShape);
+}
+
+void MascotOverlay::invalidate(QRect const& globalRect) {
+    if (globalRect.isEmpty()) {
+        return;
+    }
+    auto local = globalRect.translated(-pos()) & rect();
+    if (!local.isEmpty()) {
+        m_dirty += local;
+    }
+}
+
+void MascotOverlay::flush() {
+    if (m_dirty.isEmpty()) {
+        return;
+    }
+    // Only opaque pixels take input, clicks on the transparent parts of
+    // a mascot's rect go through to whatever is below like they do with
+    // per-mascot windows
+    QRegion inputShape;
+    for (auto mascot : m_index->intersecting(geometry())) {
+        if (!mascot->closed()) {
+            inputShape += mascot->inputShape().translated(-pos());
+        }
+    }
+    if (inputShape.isEmpty()) {
+        inputShape = QRect { 0, 0, 1, 1 };
+    }
+    if (inputShape != m_inputShape) {
+        m_inputShape = inputShape;
+        setMask(m_inputShape);
+#ifdef __linux__
+        ShijimaWidget::shapeUpdateCounter().add();
+#endif
+    }
+    update(m_dirty);
+    m_dirty = {};
+}
+
+void MascotOverlay::paintEvent(QPaintEvent *event) {
+    TickProfiler::Scope scope { ShijimaManager::defaultManager()->tickProfiler(),
+        TickProfiler::Paint };
+    QPainter painter { this };
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for (auto &rect : event->region()) {
+        painter.fillRect(rect, Qt::transparent);
+    }
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    auto mascots = m_index->intersecting(event->rect().translated(pos()));
+    // The index lists the topmost mascot first
+    for (auto iter = mascots.rbegin(); iter != mascots.rend(); ++iter) {
+        ShijimaWidget *mascot = *iter;
+        if (mascot->closed()) {
+            continue;
+        }
+        auto windowRect = mascot->windowRect().translated(-pos());
+        painter.save();
+        painter.setClipRect(windowRect, Qt::IntersectClip);
+        mascot->paintFrame(painter, windowRect.topLeft());
+        painter.restore();
+    }
+}
+
+void MascotOverlay::mousePressEvent(QMouseEvent *event) {
+    auto globalPos = event->globalPosition().toPoint();
+    auto target = ShijimaManager::defaultManager()->hitTest(globalPos);
+    m_pressTarget = target;
+    if (target == nullptr) {
+        event->ignore();
+        return;
+    }
+    target->pressAt(globalPos - target->windowRect().topLeft(),
+        event->button());
+}
+
+void MascotOverlay::mouseReleaseEvent(QMouseEvent *event) {
+    if (m_pressTarget == nullptr) {
+        return;
+    }
+    auto globalPos = event->globalPosition().toPoint();
+    m_pressTarget->releaseAt(globalPos - m_pressTarget->windowRect().topLeft(),
+        event->button());
+    m_pressTarget = nullptr;
+}
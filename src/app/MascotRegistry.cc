@@ -0,0 +1,135 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/MascotRegistry.hpp"
+#include "shijima-qt/ShijimaWidget.hpp"
+#include <climits>
+#include <stdexcept>
+
+// Generations wrap before the id would turn negative
+static constexpr int kMaxGeneration = INT_MAX >> MascotRegistry::kSlotBits;
+
+int MascotRegistry::makeId(int slot, int generation) {
+    return (generation << kSlotBits) | slot;
+}
+
+int MascotRegistry::nextId() const {
+    if (!m_freeSlots.empty()) {
+        int slot = m_freeSlots.back();
+        return makeId(slot, m_generations[slot]);
+    }
+    return makeId((int)m_generations.size(), 0);
+}
+
+void MascotRegistry::insert(ShijimaWidget *widget) {
+    if (full()) {
+        throw std::logic_error("insert() called on a full registry");
+    }
+    if (widget->mascotId() != nextId()) {
+        throw std::logic_error("widget was not constructed with nextId()");
+    }
+    int slot;
+    if (!m_freeSlots.empty()) {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else {
+        slot = (int)m_generations.size();
+        m_generations.push_back(0);
+        m_denseIndices.push_back(-1);
+    }
+    m_denseIndices[slot] = (int)m_widgets.size();
+    m_widgets.push_back(widget);
+    m_slots.push_back(slot);
+    m_anchorBefore.emplace_back();
+    m_windowRects.push_back(widget->windowRect());
+    m_fallTracking.push_back(false);
+    m_fallStartY.push_back(0.0);
+    m_fallThrough.push_back(false);
+}
+
+void MascotRegistry::replace(ShijimaWidget *widget) {
+    int index = indexOf(widget->mascotId());
+    if (index == -1) {
+        throw std::logic_error("replace() called for an unknown mascot");
+    }
+    m_widgets[index] = widget;
+    m_windowRects[index] = widget->windowRect();
+}
+
+void MascotRegistry::removeAt(int index) {
+    int slot = m_slots[index];
+    int last = (int)m_widgets.size() - 1;
+    if (index != last) {
+        m_widgets[index] = m_widgets[last];
+        m_slots[index] = m_slots[last];
+        m_anchorBefore[index] = m_anchorBefore[last];
+        m_windowRects[index] = m_windowRects[last];
+        m_fallTracking[index] = m_fallTracking[last];
+        m_fallStartY[index] = m_fallStartY[last];
+        m_fallThrough[index] = m_fallThrough[last];
+        m_denseIndices[m_slots[index]] = index;
+    }
+    m_widgets.pop_back();
+    m_slots.pop_back();
+    m_anchorBefore.pop_back();
+    m_windowRects.pop_back();
+    m_fallTracking.pop_back();
+    m_fallStartY.pop_back();
+    m_fallThrough.pop_back();
+    m_denseIndices[slot] = -1;
+    m_generations[slot] = (m_generations[slot] + 1) % (kMaxGeneration + 1);
+    m_freeSlots.push_back(slot);
+}
+
+void MascotRegistry::clear() {
+    while (!m_widgets.empty()) {
+        removeAt((int)m_widgets.size() - 1);
+    }
+}
+
+int MascotRegistry::indexOf(int id) const {
+    if (id < 0) {
+        return -1;
+    }
+    int slot = slotOf(id);
+    if (slot >= (int)m_generations.size() ||
+        m_generations[slot] != generationOf(id))
+    {
+        return -1;
+    }
+    return m_denseIndices[slot];
+}
+
+ShijimaWidget *MascotRegistry::find(int id) const {
+    int index = indexOf(id);
+    return index == -1 ? nullptr : m_widgets[index];
+}
+
+void MascotRegistry::startFall(int index, double y) {
+    m_fallTracking[index] = true;
+    m_fallStartY[index] = y;
+}
+
+void MascotRegistry::setFallThrough(int index, bool fallThrough) {
+    m_fallThrough[index] = fallThrough;
+    if (!fallThrough) {
+        m_fallTracking[index] = false;
+    }
+}
@@ -0,0 +1,79 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/MascotWindowPool.hpp"
+#include "shijima-qt/ShijimaWidget.hpp"
+#include <algorithm>
+
+MascotWindowPool::~MascotWindowPool() {
+    for (auto widget : m_idle) {
+        delete widget;
+    }
+}
+
+void MascotWindowPool::setSize(int size) {
+    m_size = std::clamp(size, 0, kMaxSize);
+    while ((int)m_idle.size() > m_size) {
+        delete m_idle.back();
+        m_idle.pop_back();
+    }
+    while ((int)m_idle.size() < m_size) {
+        auto widget = new ShijimaWidget(false, m_parent);
+        // Creates the native window without mapping it
+        widget->winId();
+        m_idle.push_back(widget);
+    }
+}
+
+ShijimaWidget *MascotWindowPool::take() {
+    if (m_idle.empty()) {
+        ++m_misses;
+        return new ShijimaWidget(false, m_parent);
+    }
+    ++m_hits;
+    auto widget = m_idle.back();
+    m_idle.pop_back();
+    return widget;
+}
+
+ShijimaWidget *MascotWindowPool::acquire(MascotData *mascotData,
+    std::unique_ptr<shijima::mascot::manager> mascot, int mascotId)
+{
+    auto widget = take();
+    widget->recycle(mascotData, std::move(mascot), mascotId);
+    return widget;
+}
+
+ShijimaWidget *MascotWindowPool::acquire(ShijimaWidget &old) {
+    auto widget = take();
+    widget->recycle(old);
+    return widget;
+}
+
+void MascotWindowPool::release(ShijimaWidget *widget) {
+    // A context menu may still point at the widget
+    if (widget->windowedMode() || widget->m_contextMenuVisible ||
+        (int)m_idle.size() >= m_size)
+    {
+        delete widget;
+        return;
+    }
+    widget->retire();
+    m_idle.push_back(widget);
+}
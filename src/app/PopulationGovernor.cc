@@ -0,0 +1,79 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/PopulationGovernor.hpp"
+#include "Platform/Platform.hpp"
+#include <algorithm>
+#include <climits>
+
+// Weight of the latest tick in the average cost per mascot
+static constexpr double kCostSmoothing = 0.05;
+
+// The resident set is read from the OS, once a second is enough
+static constexpr qint64 kResidentIntervalMs = 1000;
+
+void PopulationGovernor::tickFinished(qint64 mascotNsecs, int mascotCount) {
+    if (mascotCount > 0) {
+        double cost = mascotNsecs / 1e6 / mascotCount;
+        if (!m_measured) {
+            m_mascotCostMs = cost;
+            m_measured = true;
+        }
+        else {
+            m_mascotCostMs += (cost - m_mascotCostMs) * kCostSmoothing;
+        }
+    }
+    if (m_memoryCapBytes > 0 && (!m_residentAge.isValid() ||
+        m_residentAge.elapsed() >= kResidentIntervalMs))
+    {
+        m_residentBytes = Platform::residentSetSize();
+        m_residentAge.start();
+    }
+}
+
+int PopulationGovernor::currentCap(int mascotCount) const {
+    int cap = INT_MAX;
+    if (m_mascotCap > 0) {
+        cap = m_mascotCap;
+    }
+    if (m_frameBudgetMs > 0 && m_measured && m_mascotCostMs > 0) {
+        double budgetCap = m_frameBudgetMs / m_mascotCostMs;
+        cap = std::min(cap, (int)std::min(budgetCap, (double)INT_MAX));
+    }
+    if (m_memoryCapBytes > 0 && m_residentBytes > 0 && mascotCount > 0) {
+        // Assumes memory grows linearly with the population, which
+        // overestimates the cost of a mascot since the templates are
+        // shared
+        double perMascot = (double)m_residentBytes / mascotCount;
+        double memoryCap = m_memoryCapBytes / perMascot;
+        cap = std::min(cap, (int)std::min(memoryCap, (double)INT_MAX));
+    }
+    return cap == INT_MAX ? -1 : cap;
+}
+
+PopulationGovernor::Decision PopulationGovernor::admit(int mascotCount) const {
+    if (m_memoryCapBytes > 0 && m_residentBytes >= m_memoryCapBytes) {
+        return Decision::Defer;
+    }
+    int cap = currentCap(mascotCount);
+    if (cap != -1 && mascotCount + 1 > cap) {
+        return Decision::Defer;
+    }
+    return Decision::Allow;
+}
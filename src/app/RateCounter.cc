@@ -0,0 +1,46 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/RateCounter.hpp"
+
+void RateCounter::roll() {
+    if (!m_timer.isValid()) {
+        m_timer.start();
+        return;
+    }
+    qint64 elapsed = m_timer.elapsed();
+    if (elapsed < 1000) {
+        return;
+    }
+    // After more than two seconds without a roll, the last full second
+    // had no events at all
+    m_rate = elapsed < 2000 ? m_count * 1000.0 / elapsed : 0.0;
+    m_count = 0;
+    m_timer.start();
+}
+
+void RateCounter::add(int count) {
+    roll();
+    m_count += count;
+}
+
+double RateCounter::rate() {
+    roll();
+    return m_rate;
+}
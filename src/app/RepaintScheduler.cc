@@ -0,0 +1,60 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/RepaintScheduler.hpp"
+
+void RepaintScheduler::setRefreshRate(double hz) {
+    if (hz < 1.0) {
+        hz = 60.0;
+    }
+    m_frameInterval = (qint64)(1000000000.0 / hz);
+}
+
+bool RepaintScheduler::frameDue() {
+    if (!m_clock.isValid()) {
+        m_clock.start();
+    }
+    qint64 now = m_clock.nsecsElapsed();
+    if (now < m_nextFrame) {
+        return false;
+    }
+    // Stepping the deadline instead of restarting from now keeps the
+    // average paint rate at the refresh rate even though ticks are
+    // coarser than frames
+    m_nextFrame += m_frameInterval;
+    if (m_nextFrame <= now) {
+        // First frame or a stall, do not try to catch up
+        m_nextFrame = now + m_frameInterval;
+    }
+    return true;
+}
+
+void RepaintScheduler::tickFinished() {
+    ++m_ticks;
+    if (!m_statsTimer.isValid()) {
+        m_statsTimer.start();
+        return;
+    }
+    if (m_statsTimer.elapsed() >= 1000) {
+        m_skippedPerTick = (double)m_skipped / m_ticks;
+        m_skipped = 0;
+        m_ticks = 0;
+        m_statsTimer.start();
+    }
+}
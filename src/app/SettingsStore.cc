@@ -0,0 +1,127 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/SettingsStore.hpp"
+#include <QSettings>
+
+static SettingsStore *m_defaultStore = nullptr;
+
+// The scope the settings have always been stored under
+static const char *kOrganization = "pixelomer";
+static const char *kApplication = "Shijima-Qt";
+
+SettingsStore *SettingsStore::defaultStore() {
+    if (m_defaultStore == nullptr) {
+        m_defaultStore = new SettingsStore;
+    }
+    return m_defaultStore;
+}
+
+void SettingsStore::finalize() {
+    if (m_defaultStore != nullptr) {
+        delete m_defaultStore;
+        m_defaultStore = nullptr;
+    }
+}
+
+SettingsStore::SettingsStore() {
+    QSettings settings { kOrganization, kApplication };
+    for (auto &key : settings.allKeys()) {
+        m_values[key] = settings.value(key);
+        refresh(key);
+    }
+    m_writer.setMaxThreadCount(1);
+    m_writeTimer.setSingleShot(true);
+    m_writeTimer.setInterval(kWriteDelayMs);
+    connect(&m_writeTimer, &QTimer::timeout, this, &SettingsStore::write);
+}
+
+SettingsStore::~SettingsStore() {
+    sync();
+}
+
+QVariant SettingsStore::value(QString const& key,
+    QVariant const& defaultValue) const
+{
+    auto iter = m_values.constFind(key);
+    if (iter == m_values.constEnd()) {
+        return defaultValue;
+    }
+    return *iter;
+}
+
+void SettingsStore::setValue(QString const& key, QVariant const& value) {
+    auto iter = m_values.find(key);
+    if (iter != m_values.end() && *iter == value) {
+        return;
+    }
+    m_values[key] = value;
+    m_dirty.insert(key);
+    refresh(key);
+    m_writeTimer.start();
+    emit valueChanged(key, value);
+}
+
+void SettingsStore::refresh(QString const& key) {
+    auto const& value = m_values[key];
+    if (key == "speechBubbleEnabled") {
+        m_speechBubbleEnabled = value.toBool();
+    }
+    else if (key == "speechBubbleClickCount") {
+        m_speechBubbleClickCount = value.toInt();
+    }
+    else if (key == "multiplicationEnabled") {
+        m_multiplicationEnabled = value.toBool();
+    }
+    else if (key == "detachThreshold") {
+        m_detachThreshold = value.toDouble();
+    }
+    else if (key == "assetCacheBudget") {
+        m_assetCacheBudget = value.toInt();
+    }
+    else if (key == "overlayRendering") {
+        m_overlayRendering = value.toBool();
+    }
+}
+
+void SettingsStore::write() {
+    m_writeTimer.stop();
+    if (m_dirty.isEmpty()) {
+        return;
+    }
+    QHash<QString, QVariant> changes;
+    for (auto &key : m_dirty) {
+        changes[key] = m_values[key];
+    }
+    m_dirty.clear();
+    m_writer.start([changes]() {
+        QSettings settings { kOrganization, kApplication };
+        for (auto iter = changes.constBegin(); iter != changes.constEnd(); ++iter) {
+            settings.setValue(iter.key(), iter.value());
+        }
+        settings.sync();
+    });
+}
+
+void SettingsStore::sync() {
+    write();
+    m_writer.waitForDone();
+}
+
+#include "SettingsStore.moc"
@@ -19,6 +19,8 @@
 #include "shijima-qt/ShijimaHttpApi.hpp"
 #include <httplib.h>
 #include "shijima-qt/ShijimaManager.hpp"
+#include "shijima-qt/AssetLoader.hpp"
+#include "shijima-qt/SoundBank.hpp"
 #include <thread>
 #include <iostream>
 #include <QJsonArray>
@@ -74,6 +76,7 @@ static shijima::math::vec2 valueToVec(QJsonValue const& value) {
 }
 
 static void applyObjectToWidget(QJsonObject &object, ShijimaWidget *widget) {
+    widget->wake();
     if (auto anchor = valueToVec(object.take("anchor"));
         !std::isnan(anchor.x))
     {
@@ -89,6 +92,91 @@ static void applyObjectToWidget(QJsonObject &object, ShijimaWidget *widget) {
     }
 }
 
+static QJsonObject profilerToObject(TickProfiler const& profiler) {
+    QJsonObject obj;
+    obj["enabled"] = profiler.enabled();
+    obj["window_ticks"] = TickProfiler::kWindowTicks;
+    QJsonObject phases;
+    if (profiler.enabled()) {
+        for (int i=0; i<TickProfiler::PhaseCount; ++i) {
+            auto phase = (TickProfiler::Phase)i;
+            auto stats = profiler.statistics(phase);
+            QJsonObject phaseObj;
+            phaseObj["ticks"] = stats.ticks;
+            phaseObj["p50_us"] = stats.p50;
+            phaseObj["p95_us"] = stats.p95;
+            phaseObj["p99_us"] = stats.p99;
+            phaseObj["max_us"] = stats.max;
+            phases[TickProfiler::phaseName(phase)] = phaseObj;
+        }
+    }
+    obj["phases"] = phases;
+    return obj;
+}
+
+static QJsonObject statsToObject(ShijimaManager *manager) {
+    QJsonObject obj = profilerToObject(manager->tickProfiler());
+    auto &pool = manager->windowPool();
+    QJsonObject poolObj;
+    poolObj["size"] = pool.size();
+    poolObj["idle"] = pool.idle();
+    poolObj["hits"] = (double)pool.hits();
+    poolObj["misses"] = (double)pool.misses();
+    obj["window_pool"] = poolObj;
+    auto &scheduler = manager->tickScheduler();
+    QJsonObject schedulerObj;
+    schedulerObj["jitter_ms"] = scheduler.jitterMs();
+    schedulerObj["max_jitter_ms"] = scheduler.maxJitterMs();
+    schedulerObj["dropped_subticks_per_s"] = scheduler.droppedPerSecond();
+    schedulerObj["timer_wakeups_per_s"] = manager->timerWakeups().rate();
+    schedulerObj["skipped_paints_per_tick"] =
+        manager->repaintScheduler().skippedPerTick();
+    schedulerObj["geometry_requests_per_s"] = manager->geometryRequests().rate();
+#ifdef __linux__
+    schedulerObj["shape_updates_per_s"] = ShijimaWidget::shapeUpdateCounter().rate();
+#else
+    schedulerObj["shape_updates_per_s"] = 0.0;
+#endif
+    obj["scheduler"] = schedulerObj;
+    auto &governor = manager->populationGovernor();
+    QJsonObject populationObj;
+    populationObj["cap"] = governor.currentCap((int)manager->mascots().size());
+    populationObj["queued"] = manager->deferredBreedCount();
+    populationObj["denied"] = (double)governor.denied();
+    populationObj["mascot_cost_ms"] = governor.mascotCostMs();
+    obj["population"] = populationObj;
+    auto sounds = SoundBank::defaultBank()->statistics();
+    QJsonObject soundsObj;
+    soundsObj["samples"] = sounds.samples;
+    soundsObj["decoded_bytes"] = (double)sounds.decodedBytes;
+    soundsObj["voices"] = sounds.activeVoices;
+    soundsObj["voice_limit"] = SoundBank::defaultBank()->voiceLimit();
+    soundsObj["stolen"] = (double)sounds.stolenVoices;
+    soundsObj["mixer_load"] = sounds.mixerLoad;
+    obj["sounds"] = soundsObj;
+    return obj;
+}
+
+// Parses "x,y,width,height"
+static std::optional<QRect> rectFromString(std::string const& str) {
+    auto parts = QString::fromStdString(str).split(',');
+    if (parts.size() != 4) {
+        return {};
+    }
+    int values[4];
+    for (int i=0; i<4; ++i) {
+        bool ok;
+        values[i] = parts[i].trimmed().toInt(&ok);
+        if (!ok) {
+            return {};
+        }
+    }
+    if (values[2] <= 0 || values[3] <= 0) {
+        return {};
+    }
+    return QRect { values[0], values[1], values[2], values[3] };
+}
+
 static std::optional<QJsonObject> jsonForRequest(Request const& req) {
     if (req.get_header_value("content-type") != "application/json") {
         return {};
@@ -150,7 +238,23 @@ ShijimaHttpApi::ShijimaHttpApi(ShijimaManager *manager): m_server(new Server),
         if (req.has_param("selector")) {
             selector = req.get_param_value("selector");
         }
-        m_manager->onTickSync([&array, &selector](ShijimaManager *manager){
+        std::optional<QRect> rect;
+        if (req.has_param("rect")) {
+            rect = rectFromString(req.get_param_value("rect"));
+            if (!rect.has_value()) {
+                badRequest(req, res);
+                return;
+            }
+        }
+        m_manager->onTickSync([&array, &selector, &rect](ShijimaManager *manager){
+            if (rect.has_value()) {
+                for (auto mascot : manager->mascotIndex().intersecting(*rect)) {
+                    if (selectorEval(mascot, selector)) {
+                        array.append(mascotToObject(mascot));
+                    }
+                }
+                return;
+            }
             auto &mascots = manager->mascots();
             for (auto mascot : mascots) {
                 if (!selectorEval(mascot, selector)) {
@@ -203,6 +307,11 @@ ShijimaHttpApi::ShijimaHttpApi(ShijimaManager *manager): m_server(new Server),
             }
             else {
                 auto widget = manager->spawn(mascotName.toStdString());
+                if (widget == nullptr) {
+                    res.status = 503;
+                    object["error"] = "Too many mascots";
+                    return;
+                }
                 applyObjectToWidget(*json, widget);
                 object["mascot"] = mascotToObject(widget);
             }
@@ -222,8 +331,8 @@ ShijimaHttpApi::ShijimaHttpApi(ShijimaManager *manager): m_server(new Server),
         m_manager->onTickSync([&json, &object, &res, id]
             (ShijimaManager *manager)
         {
-            if (manager->mascotsById().count(id) == 1) {
-                auto widget = manager->mascotsById().at(id);
+            auto widget = manager->mascotById(id);
+            if (widget != nullptr) {
                 applyObjectToWidget(*json, widget);
                 object["mascot"] = mascotToObject(widget);
             }
@@ -240,8 +349,9 @@ ShijimaHttpApi::ShijimaHttpApi(ShijimaManager *manager): m_server(new Server),
         auto id = std::stoi(req.matches[1].str());
         QJsonObject object;
         m_manager->onTickSync([&object, &res, id](ShijimaManager *manager){
-            if (manager->mascotsById().count(id) == 1) {
-                object["mascot"] = mascotToObject(manager->mascotsById().at(id));
+            auto widget = manager->mascotById(id);
+            if (widget != nullptr) {
+                object["mascot"] = mascotToObject(widget);
             }
             else {
                 res.status = 404;
@@ -256,8 +366,8 @@ ShijimaHttpApi::ShijimaHttpApi(ShijimaManager *manager): m_server(new Server),
         auto id = std::stoi(req.matches[1].str());
         QJsonObject object;
         m_manager->onTickSync([&object, &res, id](ShijimaManager *manager){
-            if (manager->mascotsById().count(id) == 1) {
-                auto mascot = manager->mascotsById().at(id);
+            auto mascot = manager->mascotById(id);
+            if (mascot != nullptr) {
                 mascot->markForDeletion();
             }
             else {
@@ -346,6 +456,50 @@ ShijimaHttpApi::ShijimaHttpApi(ShijimaManager *manager): m_server(new Server),
             }
         });
     });
+    m_server->Get("/shijima/api/v1/assetCache",
+        [](Request const&, Response &res)
+    {
+        auto stats = AssetLoader::defaultLoader()->statistics();
+        QJsonObject cache;
+        cache["hits"] = (qint64)stats.hits;
+        cache["misses"] = (qint64)stats.misses;
+        cache["evictions"] = (qint64)stats.evictions;
+        cache["sync_decodes"] = (qint64)stats.syncDecodes;
+        cache["background_decodes"] = (qint64)stats.backgroundDecodes;
+        cache["disk_cache_hits"] = (qint64)stats.diskCacheHits;
+        cache["resident_bytes"] = (qint64)stats.residentBytes;
+        cache["budget_bytes"] = (qint64)stats.budgetBytes;
+        cache["mirrored_images"] = stats.mirroredImages;
+        cache["masks"] = stats.masks;
+        QJsonObject object;
+        object["asset_cache"] = cache;
+        sendJson(res, object);
+    });
+    m_server->Get("/shijima/api/v1/stats",
+        [this](Request const&, Response &res)
+    {
+        QJsonObject object;
+        m_manager->onTickSync([&object](ShijimaManager *manager) {
+            object["stats"] = statsToObject(manager);
+        });
+        sendJson(res, object);
+    });
+    m_server->Put("/shijima/api/v1/stats",
+        [this](Request const& req, Response &res)
+    {
+        auto json = jsonForRequest(req);
+        if (!json.has_value() || !json->value("enabled").isBool()) {
+            badRequest(req, res);
+            return;
+        }
+        bool enabled = json->value("enabled").toBool();
+        QJsonObject object;
+        m_manager->onTickSync([&object, enabled](ShijimaManager *manager) {
+            manager->tickProfiler().setEnabled(enabled);
+            object["stats"] = statsToObject(manager);
+        });
+        sendJson(res, object);
+    });
     m_server->Get(".*", badRequest);
     m_server->Put(".*", badRequest);
     m_server->Post(".*", badRequest);
@@ -17,6 +17,7 @@
 // 
 
 #include "shijima-qt/ShijimaManager.hpp"
+#include <algorithm>
 #include <cmath>
 #include <exception>
 #include <filesystem>
@@ -36,6 +37,10 @@
 #include <QScreen>
 #include <QRandomGenerator>
 #include "shijima-qt/PlatformWidget.hpp"
+#include "shijima-qt/AssetLoader.hpp"
+#include "shijima-qt/SettingsStore.hpp"
+#include "shijima-qt/SoundBank.hpp"
+#include "Platform/Platform.hpp"
 #include "shijima-qt/ShijimaLicensesDialog.hpp"
 #include "shijima-qt/ShijimaWidget.hpp"
 #include <QDirIterator>
@@ -63,6 +68,7 @@
 #include <QProcess>
 #include <QUrl>
 #include <QtConcurrent>
+#include <QThread>
 #include <string>
 #include <QLabel>
 #include <QFormLayout>
@@ -88,7 +94,13 @@
 #include "ElaTheme.h"
 #include <QStyleHints>
 #include "ElaPushButton.h"
-#define SHIJIMAQT_SUBTICK_COUNT 4
+
+static constexpr int kMaxSimulationThreads = 16;
+// A mascot whose frame and anchor did not change for this many subticks
+// goes to sleep, see ShijimaManager::tick()
+static constexpr int kSleepAfterSubticks = 100;
+// Sleeping mascots wake up when the cursor comes this close
+static constexpr int kWakeDistance = 64;
 
 #ifndef NEUROLINGSCE_VERSION
 #define NEUROLINGSCE_VERSION "0.1.0"
@@ -254,12 +266,14 @@ void ShijimaManager::finalize() {
 // tray icon helpers are file-local (see above)
 
 void ShijimaManager::killAll() {
+    m_deferredBreeds.clear();
     for (auto mascot : m_mascots) {
         mascot->markForDeletion();
     }
 }
 
 void ShijimaManager::killAll(QString const& name) {
+    dropDeferredBreeds(name);
     for (auto mascot : m_mascots) {
         if (mascot->mascotName() == name) {
             mascot->markForDeletion();
@@ -268,6 +282,7 @@ void ShijimaManager::killAll(QString const& name) {
 }
 
 void ShijimaManager::killAllButOne(ShijimaWidget *widget) {
+    m_deferredBreeds.clear();
     for (auto mascot : m_mascots) {
         if (widget == mascot) {
             continue;
@@ -277,6 +292,7 @@ void ShijimaManager::killAllButOne(ShijimaWidget *widget) {
 }
 
 void ShijimaManager::killAllButOne(QString const& name) {
+    dropDeferredBreeds(name);
     bool foundOne = false;
     for (auto mascot : m_mascots) {
         if (mascot->mascotName() == name) {
@@ -289,14 +305,27 @@ void ShijimaManager::killAllButOne(QString const& name) {
     }
 }
 
+static shijima::mascot::factory::tmpl templateForData(MascotData *data) {
+    shijima::mascot::factory::tmpl tmpl;
+    tmpl.actions_xml = data->actionsXML().toStdString();
+    tmpl.behaviors_xml = data->behaviorsXML().toStdString();
+    tmpl.name = data->name().toStdString();
+    tmpl.path = data->path().toStdString();
+    return tmpl;
+}
+
 void ShijimaManager::loadData(MascotData *data) {
     if (data != nullptr && data->valid()) {
-        shijima::mascot::factory::tmpl tmpl;
-        tmpl.actions_xml = data->actionsXML().toStdString();
-        tmpl.behaviors_xml = data->behaviorsXML().toStdString();
-        tmpl.name = data->name().toStdString();
-        tmpl.path = data->path().toStdString();
-        m_factory.register_template(tmpl);
+        auto tmpl = templateForData(data);
+        for (auto &factory : m_factories) {
+            factory->register_template(tmpl);
+        }
+        AssetLoader::defaultLoader()->preloadAssets(data->id(),
+            data->imgRoot());
+        QDir soundDir { data->imgRoot() };
+        if (soundDir.exists() && soundDir.cdUp() && soundDir.cd("sound")) {
+            SoundBank::defaultBank()->preload(soundDir.absolutePath());
+        }
         m_loadedMascots.insert(data->name(), data);
         m_loadedMascotsById.insert(data->id(), data);
         std::cout << "Loaded mascot: " << data->name().toStdString() << std::endl;
@@ -319,12 +348,12 @@ QMap<int, MascotData *> const& ShijimaManager::loadedMascotsById() {
     return m_loadedMascotsById;
 }
 
-std::list<ShijimaWidget *> const& ShijimaManager::mascots() {
+MascotRegistry const& ShijimaManager::mascots() {
     return m_mascots;
 }
 
-std::map<int, ShijimaWidget *> const& ShijimaManager::mascotsById() {
-    return m_mascotsById;
+ShijimaWidget *ShijimaManager::mascotById(int id) {
+    return m_mascots.find(id);
 }
 
 
@@ -345,7 +374,9 @@ void ShijimaManager::reloadMascot(QString const& name) {
     }
     if (m_loadedMascots.contains(name)) {
         MascotData *data = m_loadedMascots[name];
-        m_factory.deregister_template(name.toStdString());
+        for (auto &factory : m_factories) {
+            factory->deregister_template(name.toStdString());
+        }
         data->unloadCache();
         killAll(name);
         m_loadedMascots.remove(name);
@@ -488,8 +519,7 @@ void ShijimaManager::setupNavigation() {
 
     // --- Multiplication ---
     {
-        static const QString key = "multiplicationEnabled";
-        bool initial = m_settings.value(key, QVariant::fromValue(true)).toBool();
+        bool initial = m_settings.multiplicationEnabled();
         for (auto &env : m_env) env->allows_breeding = initial;
 
         auto *area = new ElaScrollPageArea(m_settingsPage);
@@ -502,17 +532,91 @@ void ShijimaManager::setupNavigation() {
         auto *toggle = new ElaToggleSwitch(m_settingsPage);
         toggle->setIsToggled(initial);
         connect(toggle, &ElaToggleSwitch::toggled, [this](bool checked){
-            for (auto &env : m_env) env->allows_breeding = checked;
             m_settings.setValue("multiplicationEnabled", QVariant::fromValue(checked));
         });
+        connect(&m_settings, &SettingsStore::valueChanged, this,
+            [this](QString const& key, QVariant const&)
+        {
+            if (key != "multiplicationEnabled") {
+                return;
+            }
+            bool enabled = m_settings.multiplicationEnabled();
+            for (auto &env : m_env) env->allows_breeding = enabled;
+            if (!enabled) {
+                m_deferredBreeds.clear();
+            }
+        });
         row->addWidget(toggle);
         settingsLayout->addWidget(area);
     }
 
+    // --- Breeding Frame Budget ---
+    {
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Breeding Frame Budget (ms)"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *spinBox = new QSpinBox(m_settingsPage);
+        spinBox->setRange(0, 100);
+        spinBox->setSpecialValueText(tr("Off"));
+        spinBox->setValue(qRound(m_populationGovernor.frameBudgetMs()));
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val){
+            m_populationGovernor.setFrameBudgetMs(val);
+            m_settings.setValue("breedingFrameBudget", val);
+        });
+        row->addWidget(spinBox);
+        settingsLayout->addWidget(area);
+    }
+
+    // --- Mascot Cap ---
+    {
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Maximum Mascots from Breeding"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *spinBox = new QSpinBox(m_settingsPage);
+        spinBox->setRange(0, MascotRegistry::kMaxMascots);
+        spinBox->setSpecialValueText(tr("Off"));
+        spinBox->setValue(m_populationGovernor.mascotCap());
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val){
+            m_populationGovernor.setMascotCap(val);
+            m_settings.setValue("breedingMascotCap", val);
+        });
+        row->addWidget(spinBox);
+        settingsLayout->addWidget(area);
+    }
+
+    // --- Memory Cap ---
+    {
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Breeding Memory Cap (MB)"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *spinBox = new QSpinBox(m_settingsPage);
+        spinBox->setRange(0, 65536);
+        spinBox->setSingleStep(128);
+        spinBox->setSpecialValueText(tr("Off"));
+        spinBox->setValue((int)(m_populationGovernor.memoryCapBytes() / (1024 * 1024)));
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val){
+            m_populationGovernor.setMemoryCapBytes((qint64)val * 1024 * 1024);
+            m_settings.setValue("breedingMemoryCap", val);
+        });
+        row->addWidget(spinBox);
+        settingsLayout->addWidget(area);
+    }
+
     // --- Speech Bubble ---
     {
-        static const QString key = "speechBubbleEnabled";
-        bool initial = m_settings.value(key, QVariant::fromValue(true)).toBool();
+        bool initial = m_settings.speechBubbleEnabled();
 
         auto *area = new ElaScrollPageArea(m_settingsPage);
         auto *row = new QHBoxLayout(area);
@@ -532,8 +636,7 @@ void ShijimaManager::setupNavigation() {
 
     // --- Speech Bubble Click Count ---
     {
-        static const QString key = "speechBubbleClickCount";
-        int initial = m_settings.value(key, 1).toInt();
+        int initial = m_settings.speechBubbleClickCount();
 
         auto *area = new ElaScrollPageArea(m_settingsPage);
         auto *row = new QHBoxLayout(area);
@@ -552,6 +655,69 @@ void ShijimaManager::setupNavigation() {
         settingsLayout->addWidget(area);
     }
 
+    // --- Subticks per Tick ---
+    {
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Subticks per Tick"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *spinBox = new QSpinBox(m_settingsPage);
+        spinBox->setRange(1, TickScheduler::kMaxSubtickCount);
+        spinBox->setValue(m_tickScheduler.subtickCount());
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val){
+            m_tickScheduler.setSubtickCount(val);
+            m_settings.setValue("subtickCount", val);
+        });
+        row->addWidget(spinBox);
+        settingsLayout->addWidget(area);
+    }
+
+    // --- Simulation Threads ---
+    {
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Simulation Threads"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *spinBox = new QSpinBox(m_settingsPage);
+        spinBox->setRange(1, maxSimulationThreads());
+        spinBox->setValue(m_simulationThreads);
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val){
+            setSimulationThreads(val);
+            m_settings.setValue("simulationThreads", val);
+        });
+        row->addWidget(spinBox);
+        settingsLayout->addWidget(area);
+    }
+
+    // --- Frame Cache Budget ---
+    {
+        int initial = m_settings.assetCacheBudget();
+
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Frame Cache Budget (MB)"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *spinBox = new QSpinBox(m_settingsPage);
+        spinBox->setRange(32, 8192);
+        spinBox->setSingleStep(32);
+        spinBox->setValue(initial);
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val){
+            AssetLoader::defaultLoader()->setBudget((qint64)val * 1024 * 1024);
+            m_settings.setValue("assetCacheBudget", val);
+        });
+        row->addWidget(spinBox);
+        settingsLayout->addWidget(area);
+    }
+
     // --- Windowed Mode ---
     {
         auto *area = new ElaScrollPageArea(m_settingsPage);
@@ -576,6 +742,83 @@ void ShijimaManager::setupNavigation() {
         settingsLayout->addWidget(area);
     }
 
+    // --- Overlay Rendering ---
+    {
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Draw All Mascots in One Window per Screen"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *toggle = new ElaToggleSwitch(m_settingsPage);
+        toggle->setIsToggled(m_overlayRendering);
+        connect(toggle, &ElaToggleSwitch::toggled, [this](bool checked){
+            setOverlayRendering(checked);
+        });
+        row->addWidget(toggle);
+        settingsLayout->addWidget(area);
+    }
+
+    // --- Window Pool ---
+    {
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Spare Mascot Windows"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *spinBox = new QSpinBox(m_settingsPage);
+        spinBox->setRange(0, MascotWindowPool::kMaxSize);
+        spinBox->setValue(m_windowPool.size());
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val){
+            m_windowPool.setSize(val);
+            m_settings.setValue("windowPoolSize", val);
+        });
+        row->addWidget(spinBox);
+        settingsLayout->addWidget(area);
+    }
+
+    // --- Sound Voices ---
+    {
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Simultaneous Sounds"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *spinBox = new QSpinBox(m_settingsPage);
+        spinBox->setRange(1, SoundBank::kMaxVoices);
+        spinBox->setValue(SoundBank::defaultBank()->voiceLimit());
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val){
+            SoundBank::defaultBank()->setVoiceLimit(val);
+            m_settings.setValue("soundVoiceLimit", val);
+        });
+        row->addWidget(spinBox);
+        settingsLayout->addWidget(area);
+    }
+
+    // --- Tick Profiler ---
+    {
+        auto *area = new ElaScrollPageArea(m_settingsPage);
+        auto *row = new QHBoxLayout(area);
+        auto *label = new ElaText(tr("Profile Tick Phases"), m_settingsPage);
+        label->setWordWrap(false);
+        label->setTextPixelSize(15);
+        row->addWidget(label);
+        row->addStretch();
+        auto *toggle = new ElaToggleSwitch(m_settingsPage);
+        toggle->setIsToggled(m_tickProfiler.enabled());
+        connect(toggle, &ElaToggleSwitch::toggled, [this](bool checked){
+            m_tickProfiler.setEnabled(checked);
+            m_settings.setValue("tickProfiler", checked);
+        });
+        row->addWidget(toggle);
+        settingsLayout->addWidget(area);
+    }
+
     // --- Background Color ---
     {
         static const QString key = "windowedModeBackground";
@@ -1030,6 +1273,18 @@ void ShijimaManager::screenAdded(QScreen *screen) {
         if (screen != primary && m_env.contains(primary)) {
             m_env[screen]->allows_breeding = m_env[primary]->allows_breeding;
         }
+        if (screen != nullptr) {
+            connect(screen, &QScreen::geometryChanged, this, [this, screen]() {
+                invalidateScreenGeometry(screen);
+            });
+            connect(screen, &QScreen::availableGeometryChanged, this, [this, screen]() {
+                invalidateScreenGeometry(screen);
+            });
+        }
+    }
+    invalidateScreenGeometry(screen);
+    if (screen != nullptr && !m_constructing) {
+        updateOverlays();
     }
 }
 
@@ -1042,6 +1297,13 @@ void ShijimaManager::screenRemoved(QScreen *screen) {
         }
         m_reverseEnv.remove(m_env[primary].get());
         m_env.remove(screen);
+        m_screenGeometry.remove(screen);
+        m_laneEnvironments.clear();
+    }
+    if (m_overlays.contains(screen)) {
+        auto overlay = m_overlays.take(screen);
+        overlay->close();
+        delete overlay;
     }
 }
 
@@ -1070,6 +1332,8 @@ void ShijimaManager::onTickSync(std::function<void(ShijimaManager *)> callback)
     }
     m_hasTickCallbacks = true;
     m_tickCallbacks.push_back(callback);
+    QMetaObject::invokeMethod(this, &ShijimaManager::wakeTicks,
+        Qt::QueuedConnection);
     m_tickCallbackCompletion.wait(lock, [this]{
         return m_shuttingDown.load() || m_tickCallbacks.empty();
     });
@@ -1081,6 +1345,7 @@ void ShijimaManager::setWindowedMode(bool windowedMode) {
         return;
     }
     m_windowedModeAction->setChecked(windowedMode);
+    m_deferredBreeds.clear();
     for (auto mascot : m_mascots) {
         mascot->close();
         mascot->setParent(nullptr);
@@ -1096,6 +1361,7 @@ void ShijimaManager::setWindowedMode(bool windowedMode) {
         m_sandboxWidget->setAttribute(Qt::WA_StyledBackground, true);
         m_sandboxWidget->resize(640, 480);
         m_sandboxWidget->setObjectName("sandboxWindow");
+        m_sandboxWidget->installEventFilter(this);
         m_sandboxWidget->show();
         updateSandboxBackground();
     }
@@ -1104,6 +1370,7 @@ void ShijimaManager::setWindowedMode(bool windowedMode) {
         delete m_sandboxWidget;
         m_sandboxWidget = nullptr;
     }
+    invalidateScreenGeometry(nullptr);
     updateEnvironment();
     std::shared_ptr<shijima::mascot::environment> env;
     if (windowedMode) {
@@ -1112,20 +1379,132 @@ void ShijimaManager::setWindowedMode(bool windowedMode) {
     else {
         env = m_env[mascotScreen()];
     }
-    for (auto &mascot : m_mascots) {
+    for (int i = 0; i < m_mascots.size(); ++i) {
+        auto mascot = m_mascots.at(i);
         bool inspectorWasVisible = mascot->inspectorVisible();
-        auto newMascot = new ShijimaWidget(*mascot, windowedMode,
-            mascotParent());
+        // The old widgets were reparented and lost their window type,
+        // so they are not returned to the pool
+        ShijimaWidget *newMascot;
+        if (windowedMode) {
+            newMascot = new ShijimaWidget(*mascot, true, mascotParent());
+        }
+        else {
+            newMascot = m_windowPool.acquire(*mascot);
+        }
         newMascot->setEnv(env);
+        m_mascotIndex.remove(mascot);
         delete mascot;
         mascot = newMascot;
-        m_mascotsById[mascot->mascotId()] = mascot;
+        m_mascots.replace(mascot);
+        m_mascots.setFallThrough(i, false);
         mascot->mascot().reset_position();
-        mascot->show();
+        showMascot(mascot);
+        if (inspectorWasVisible) {
+            mascot->showInspector();
+        }
+    }
+    updateOverlays();
+}
+
+bool ShijimaManager::usesOverlays() {
+    return m_overlayRendering && !windowedMode();
+}
+
+void ShijimaManager::setOverlayRendering(bool enabled) {
+    if (m_overlayRendering == enabled) {
+        return;
+    }
+    m_overlayRendering = enabled;
+    m_settings.setValue("overlayRendering", QVariant::fromValue(enabled));
+    if (windowedMode()) {
+        // Takes effect when windowed mode is turned off
+        return;
+    }
+    for (int i = 0; i < m_mascots.size(); ++i) {
+        auto mascot = m_mascots.at(i);
+        bool inspectorWasVisible = mascot->inspectorVisible();
+        auto env = mascot->env();
+        auto newMascot = m_windowPool.acquire(*mascot);
+        newMascot->setEnv(env);
+        m_mascotIndex.remove(mascot);
+        mascot->close();
+        m_windowPool.release(mascot);
+        mascot = newMascot;
+        m_mascots.replace(mascot);
+        showMascot(mascot);
         if (inspectorWasVisible) {
             mascot->showInspector();
         }
     }
+    updateOverlays();
+}
+
+void ShijimaManager::updateOverlays() {
+    bool wanted = usesOverlays();
+    for (auto iter = m_overlays.begin(); iter != m_overlays.end(); ) {
+        if (!wanted || !QGuiApplication::screens().contains(iter.key())) {
+            (*iter)->close();
+            delete *iter;
+            iter = m_overlays.erase(iter);
+        }
+        else {
+            ++iter;
+        }
+    }
+    if (!wanted) {
+        return;
+    }
+    for (auto screen : QGuiApplication::screens()) {
+        if (!m_overlays.contains(screen)) {
+            auto overlay = new MascotOverlay { screen, &m_mascotIndex, this };
+            overlay->show();
+            m_overlays[screen] = overlay;
+        }
+    }
+}
+
+void ShijimaManager::showMascot(ShijimaWidget *mascot) {
+    if (usesOverlays()) {
+        mascot->setComposited(true);
+    }
+    else {
+        mascot->show();
+    }
+}
+
+void ShijimaManager::flushPaints() {
+    for (auto mascot : m_mascots) {
+        if (mascot->applyGeometry() && !mascot->composited()) {
+            m_geometryRequests.add();
+        }
+        if (!mascot->composited() && mascot->m_paintPending) {
+            mascot->m_paintPending = false;
+            mascot->update();
+        }
+    }
+    compositeMascots();
+}
+
+void ShijimaManager::compositeMascots() {
+    if (m_overlays.isEmpty()) {
+        return;
+    }
+    for (auto mascot : m_mascots) {
+        QRect rect = mascot->closed() ? QRect {} : mascot->windowRect();
+        bool dirty = mascot->m_paintPending;
+        mascot->m_paintPending = false;
+        if (!dirty && rect == mascot->m_compositedRect) {
+            continue;
+        }
+        for (auto overlay : m_overlays) {
+            overlay->invalidate(mascot->m_compositedRect);
+            overlay->invalidate(rect);
+        }
+        mascot->m_compositedRect = rect;
+    }
+    for (auto overlay : m_overlays) {
+        overlay->flush();
+    }
 }
 
 void ShijimaManager::updateStatusBar() {
@@ -1134,16 +1513,22 @@ void ShijimaManager::updateStatusBar() {
     }
     int mascotCount = static_cast<int>(m_mascots.size());
     int templateCount = m_loadedMascots.size();
-    m_statusLabel->setText(tr("  Mascots: %1  |  Templates: %2")
-        .arg(mascotCount).arg(templateCount));
+    QString status = tr("  Mascots: %1  |  Templates: %2")
+        .arg(mascotCount).arg(templateCount);
+    int cap = m_populationGovernor.currentCap(mascotCount);
+    status += tr("  |  Mascot cap: %1  |  Breed queue: %2 (denied %3)")
+        .arg(cap == -1 ? tr("none") : QString::number(cap))
+        .arg((int)m_deferredBreeds.size())
+        .arg(m_populationGovernor.denied());
+    m_statusLabel->setText(status);
 }
 
 ShijimaManager::ShijimaManager(QWidget *parent):
     PlatformWidget(parent, PlatformWidget::ShowOnAllDesktops),
     m_sandboxWidget(nullptr),
-    m_settings("pixelomer", "Shijima-Qt"),
+    m_settings(*SettingsStore::defaultStore()),
     m_windowedModeAction(nullptr),
-    m_idCounter(0), m_httpApi(this),
+    m_idCounter(0), m_windowPool(this), m_httpApi(this),
     m_hasTickCallbacks(false),
     m_translator(nullptr),
     m_qtTranslator(nullptr),
@@ -1177,12 +1562,20 @@ ShijimaManager::ShijimaManager(QWidget *parent):
     }
     m_mascotsPath = mascotsPath;
     std::cout << "Mascots path: " << m_mascotsPath.toStdString() << std::endl;
+
+    setSimulationThreads(m_settings.value("simulationThreads", 1).toInt());
     
     loadDefaultMascot();
     loadAllMascots();
     setAcceptDrops(true);
 
-    m_mascotTimer = startTimer(40 / SHIJIMAQT_SUBTICK_COUNT);
+    m_tickScheduler.setSubtickCount(m_settings.value("subtickCount",
+        TickScheduler::kDefaultSubtickCount).toInt());
+    m_mascotTimer.setSingleShot(true);
+    m_mascotTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_mascotTimer, &QTimer::timeout, this,
+        &ShijimaManager::mascotTimerFired);
+    scheduleTick();
     if (m_windowObserver.tickFrequency() > 0) {
         m_windowObserverTimer = startTimer(m_windowObserver.tickFrequency());
     }
@@ -1276,6 +1669,10 @@ ShijimaManager::ShijimaManager(QWidget *parent):
     m_statusLabel = new QLabel(this);
     elaStatusBar->addWidget(m_statusLabel, 1);
     updateStatusBar();
+    // Ticks are too frequent to refresh the status bar after each one
+    m_statusTimer.setInterval(1000);
+    connect(&m_statusTimer, &QTimer::timeout, this, &ShijimaManager::updateStatusBar);
+    m_statusTimer.start();
 
     // Load saved language before building UI
     QString savedLang = m_settings.value("language", "en").toString();
@@ -1284,13 +1681,43 @@ ShijimaManager::ShijimaManager(QWidget *parent):
         switchLanguage(savedLang);
     }
 
+    // Load frame cache budget setting
+    AssetLoader::defaultLoader()->setBudget(
+        (qint64)m_settings.assetCacheBudget() * 1024 * 1024);
+
     // Load detachment threshold setting
-    m_detachThreshold = m_settings.value("detachThreshold",
-        QVariant::fromValue(30.0)).toDouble();
+    m_detachThreshold = m_settings.detachThreshold();
+
+    m_overlayRendering = m_settings.overlayRendering();
+
+    m_tickProfiler.setEnabled(m_settings.value("tickProfiler",
+        QVariant::fromValue(false)).toBool());
+
+    // Load breeding limits
+    m_populationGovernor.setFrameBudgetMs(m_settings.value("breedingFrameBudget",
+        PopulationGovernor::kDefaultFrameBudgetMs).toDouble());
+    m_populationGovernor.setMascotCap(m_settings.value("breedingMascotCap",
+        0).toInt());
+    m_populationGovernor.setMemoryCapBytes((qint64)m_settings.value(
+        "breedingMemoryCap", 0).toInt() * 1024 * 1024);
+
+    SoundBank::defaultBank()->setVoiceLimit(m_settings.value("soundVoiceLimit",
+        SoundBank::kDefaultVoiceLimit).toInt());
+
+    // Warm up the mascot window pool
+    m_windowPool.setSize(m_settings.value("windowPoolSize",
+        MascotWindowPool::kDefaultSize).toInt());
+
+    double refreshRate = 0.0;
+    for (auto screen : QGuiApplication::screens()) {
+        refreshRate = std::max(refreshRate, (double)screen->refreshRate());
+    }
+    m_repaintScheduler.setRefreshRate(refreshRate);
 
     setupNavigation();
     setManagerVisible(true);
     m_constructing = false;
+    updateOverlays();
 
     setupTrayIconFor(this);
 
@@ -1323,10 +1750,8 @@ void ShijimaManager::closeEvent(QCloseEvent *event) {
     // Wake them up first so the server thread can exit cleanly.
     abortPendingCallbacks();
     m_httpApi.stop();
-    if (m_mascotTimer != 0) {
-        killTimer(m_mascotTimer);
-        m_mascotTimer = 0;
-    }
+    m_mascotTimer.stop();
+    m_mascotTimerState = TickTimerState::Closed;
     if (m_windowObserverTimer != 0) {
         killTimer(m_windowObserverTimer);
         m_windowObserverTimer = 0;
@@ -1340,11 +1765,71 @@ void ShijimaManager::closeEvent(QCloseEvent *event) {
 
 void ShijimaManager::timerEvent(QTimerEvent *event) {
     int timerId = event->timerId();
-    if (timerId == m_mascotTimer) {
+    if (timerId == m_windowObserverTimer) {
+        TickProfiler::Scope scope { m_tickProfiler, TickProfiler::WindowObserver };
+        m_windowObserver.tick();
+    }
+}
+
+void ShijimaManager::mascotTimerFired() {
+    m_mascotTimerState = TickTimerState::Stopped;
+    m_timerWakeups.add();
+    int due = m_tickScheduler.subticksDue();
+    for (int i=0; i<due; ++i) {
         tick();
     }
-    else if (timerId == m_windowObserverTimer) {
-        m_windowObserver.tick();
+    if (m_mascotTimerState == TickTimerState::Closed) {
+        return;
+    }
+    if (m_mascots.empty() && !m_hasTickCallbacks) {
+        // Nothing to simulate. wakeTicks() starts the timer again
+        // once there is.
+        return;
+    }
+    scheduleTick();
+}
+
+void ShijimaManager::scheduleTick() {
+    if (m_allAsleep && m_subtickPhase != 0 && !m_hasTickCallbacks) {
+        // Sleeping mascots only step on the first subtick of a tick, so
+        // the subticks until then are skipped instead of waking up for
+        // each of them
+        m_tickScheduler.skipSubticks(m_tickScheduler.subtickCount() -
+            m_subtickPhase);
+        m_subtickPhase = 0;
+    }
+    // Re-armed after every wake-up so the timer follows the scheduler's
+    // deadlines instead of accumulating its own drift. start() on the
+    // active single-shot timer just moves its deadline.
+    m_mascotTimer.start(m_tickScheduler.msUntilNextSubtick());
+    m_mascotTimerState = TickTimerState::Armed;
+}
+
+void ShijimaManager::wakeTicks() {
+    if (m_shuttingDown.load() ||
+        m_mascotTimerState == TickTimerState::Closed)
+    {
+        return;
+    }
+    if (m_mascotTimerState == TickTimerState::Stopped || m_allAsleep) {
+        // Either the timer was stopped or the subticks until the next
+        // deadline were skipped. There is nothing to make up for.
+        m_tickScheduler.restart();
+    }
+    m_allAsleep = false;
+    scheduleTick();
+}
+
+void ShijimaManager::stopTicks() {
+    if (m_mascotTimerState == TickTimerState::Armed) {
+        m_mascotTimer.stop();
+        m_mascotTimerState = TickTimerState::Stopped;
+    }
+}
+
+void ShijimaManager::invalidateScreenGeometry(QScreen *screen) {
+    if (m_screenGeometry.contains(screen)) {
+        m_screenGeometry[screen].valid = false;
     }
 }
 
@@ -1353,103 +1838,159 @@ void ShijimaManager::updateEnvironment(QScreen *screen) {
         return;
     }
     auto &env = m_env[screen];
-    QRect geometry, available;
+    auto &cached = m_screenGeometry[screen];
+    if (!cached.valid) {
+        QRect geometry, available;
+        if (screen == nullptr) {
+            if (m_sandboxWidget != nullptr) {
+                geometry = m_sandboxWidget->geometry();
+                cached.origin = geometry.topLeft();
+                geometry.setCoords(0, 0, geometry.width(), geometry.height());
+                available = geometry;
+            }
+            else {
+                std::cerr << "warning: sandboxWidget is not initialized" << std::endl;
+            }
+        }
+        else {
+            cached.origin = {};
+            geometry = screen->geometry();
+            available = screen->availableGeometry();
+        }
+        int taskbarHeight = geometry.bottom() - available.bottom();
+        int statusBarHeight = available.top() - geometry.top();
+        if (taskbarHeight < 0) {
+            taskbarHeight = 0;
+        }
+        if (statusBarHeight < 0) {
+            statusBarHeight = 0;
+        }
+        cached.screen = { (double)geometry.top() + statusBarHeight,
+            (double)geometry.right(),
+            (double)geometry.bottom(),
+            (double)geometry.left() };
+        cached.floor = { (double)geometry.bottom() - taskbarHeight,
+            (double)geometry.left(), (double)geometry.right() };
+        cached.work_area = { (double)geometry.top(),
+            (double)geometry.right(),
+            (double)geometry.bottom() - taskbarHeight,
+            (double)geometry.left() };
+        cached.ceiling = { (double)geometry.top(), (double)geometry.left(),
+            (double)geometry.right() };
+        cached.valid = (screen != nullptr || m_sandboxWidget != nullptr);
+        // Sleeping mascots have to react to moved screens
+        m_environmentChanged = true;
+    }
+
+    // The borders are scaled in place by set_scale(), so they are
+    // restored from the cache every tick
+    auto previousActiveIE = env->active_ie;
+    env->screen = cached.screen;
+    env->floor = cached.floor;
+    env->work_area = cached.work_area;
+    env->ceiling = cached.ceiling;
+    if (screen == nullptr) {
+        env->active_ie = { -50, -50, -50, -50 };
+    }
+    else {
+        env->active_ie = m_activeIE;
+    }
+    if (previousActiveIE.top != env->active_ie.top ||
+        previousActiveIE.right != env->active_ie.right ||
+        previousActiveIE.bottom != env->active_ie.bottom ||
+        previousActiveIE.left != env->active_ie.left)
+    {
+        m_environmentChanged = true;
+    }
+
     QPoint cursor;
     if (screen == nullptr) {
         if (m_sandboxWidget != nullptr) {
-            geometry = m_sandboxWidget->geometry();
-            cursor = m_sandboxWidget->cursor().pos() - geometry.topLeft();
-            geometry.setCoords(0, 0, geometry.width(), geometry.height());
-            available = geometry;
-        }
-        else {
-            std::cerr << "warning: sandboxWidget is not initialized" << std::endl;
+            cursor = m_sandboxWidget->cursor().pos() - cached.origin;
         }
     }
     else {
         cursor = QCursor::pos();
-        geometry = screen->geometry();
-        available = screen->availableGeometry();
-    }
-    int taskbarHeight = geometry.bottom() - available.bottom();
-    int statusBarHeight = available.top() - geometry.top();
-    if (taskbarHeight < 0) {
-        taskbarHeight = 0;
-    }
-    if (statusBarHeight < 0) {
-        statusBarHeight = 0;
-    }
-    env->screen = { (double)geometry.top() + statusBarHeight,
-        (double)geometry.right(),
-        (double)geometry.bottom(),
-        (double)geometry.left() };
-    env->floor = { (double)geometry.bottom() - taskbarHeight,
-        (double)geometry.left(), (double)geometry.right() };
-    env->work_area = { (double)geometry.top(),
-        (double)geometry.right(),
-        (double)geometry.bottom() - taskbarHeight,
-        (double)geometry.left() };
-    env->ceiling = { (double)geometry.top(), (double)geometry.left(),
-        (double)geometry.right() };
+    }
+    int x = cursor.x(), y = cursor.y();
+    env->cursor = { (double)x, (double)y, x - env->cursor.x, y - env->cursor.y };
+    env->subtick_count = m_tickScheduler.subtickCount();
+    env->set_scale(1.0 / std::sqrt(m_userScale));
+}
+
+void ShijimaManager::updateActiveWindow() {
+    Platform::ActiveWindow window;
+    {
+        TickProfiler::Scope scope { m_tickProfiler, TickProfiler::WindowObserver };
+        window = m_windowObserver.getActiveWindow();
+    }
+    bool changed = window.available != m_currentWindow.available ||
+        window.uid != m_currentWindow.uid ||
+        window.x != m_currentWindow.x || window.y != m_currentWindow.y ||
+        window.width != m_currentWindow.width ||
+        window.height != m_currentWindow.height;
+    if (!changed) {
+        // Same window at the same place, only the deltas go away
+        m_activeIE = m_activeWindowArea;
+        return;
+    }
+    m_previousWindow = m_currentWindow;
+    m_currentWindow = window;
     if (!windowedMode() && m_currentWindow.available &&
         std::fabs(m_currentWindow.x) > 1 && std::fabs(m_currentWindow.y) > 1)
     {
-        env->active_ie = { m_currentWindow.y,
+        m_activeWindowArea = { m_currentWindow.y,
             m_currentWindow.x + m_currentWindow.width,
             m_currentWindow.y + m_currentWindow.height,
             m_currentWindow.x };
+        m_activeIE = m_activeWindowArea;
         if (m_previousWindow.available &&
             m_previousWindow.uid == m_currentWindow.uid)
         {
-            env->active_ie.dy = m_currentWindow.y - m_previousWindow.y;
-            if (env->active_ie.dy == 0) {
-                env->active_ie.dy = m_currentWindow.height - m_previousWindow.height;
+            m_activeIE.dy = m_currentWindow.y - m_previousWindow.y;
+            if (m_activeIE.dy == 0) {
+                m_activeIE.dy = m_currentWindow.height - m_previousWindow.height;
             }
-            env->active_ie.dx = m_currentWindow.x - m_previousWindow.x;
-            if (env->active_ie.dx == 0) {
-                env->active_ie.dx = m_currentWindow.width - m_previousWindow.width;
+            m_activeIE.dx = m_currentWindow.x - m_previousWindow.x;
+            if (m_activeIE.dx == 0) {
+                m_activeIE.dx = m_currentWindow.width - m_previousWindow.width;
             }
 
             // Gradual detachment: dampen dx/dy based on window speed
             if (m_detachThreshold > 0) {
-                double speed = std::sqrt(env->active_ie.dx * env->active_ie.dx
-                    + env->active_ie.dy * env->active_ie.dy);
+                double speed = std::sqrt(m_activeIE.dx * m_activeIE.dx
+                    + m_activeIE.dy * m_activeIE.dy);
                 double upperBound = m_detachThreshold * 3.0;
                 if (speed >= upperBound) {
                     // Full detachment: window moved too fast
-                    env->active_ie = { -50, -50, -50, -50 };
+                    m_activeIE = { -50, -50, -50, -50 };
                 }
                 else if (speed > m_detachThreshold) {
                     // Partial damping: linearly reduce follow ratio
                     double ratio = 1.0 - (speed - m_detachThreshold)
                         / (upperBound - m_detachThreshold);
-                    env->active_ie.dx *= ratio;
-                    env->active_ie.dy *= ratio;
+                    m_activeIE.dx *= ratio;
+                    m_activeIE.dy *= ratio;
                 }
             }
         }
     }
     else {
-        env->active_ie = { -50, -50, -50, -50 };
+        m_activeWindowArea = { -50, -50, -50, -50 };
+        m_activeIE = m_activeWindowArea;
     }
-    int x = cursor.x(), y = cursor.y();
-    env->cursor = { (double)x, (double)y, x - env->cursor.x, y - env->cursor.y };
-    env->subtick_count = SHIJIMAQT_SUBTICK_COUNT;
-
-    env->set_scale(1.0 / std::sqrt(m_userScale));
 }
 
 void ShijimaManager::updateEnvironment() {
-    m_currentWindow = m_windowObserver.getActiveWindow();
     if (windowedMode()) {
         updateEnvironment(nullptr);
     }
     else {
+        updateActiveWindow();
         for (auto screen : QGuiApplication::screens()) {
             updateEnvironment(screen);
         }
     }
-    m_previousWindow = m_currentWindow;
 }
 
 void ShijimaManager::askClose() {
@@ -1506,7 +2047,13 @@ QWidget *ShijimaManager::mascotParent() {
 }
 
 void ShijimaManager::tick() {
+    TickProfiler::Scope tickScope { m_tickProfiler, TickProfiler::Tick };
+    bool firstSubtick = m_subtickPhase == 0;
+    m_subtickPhase = (m_subtickPhase + 1) % m_tickScheduler.subtickCount();
+    // Callbacks wake up the mascots they change themselves, see
+    // ShijimaWidget::wake()
     if (m_hasTickCallbacks) {
+        TickProfiler::Scope scope { m_tickProfiler, TickProfiler::Callbacks };
         auto lock = acquireLock();
         for (auto &callback : m_tickCallbacks) {
             callback(this);
@@ -1516,6 +2063,8 @@ void ShijimaManager::tick() {
         m_tickCallbackCompletion.notify_all();
     }
 
+    AssetLoader::defaultLoader()->trim();
+
     if (m_sandboxWidget != nullptr && !m_sandboxWidget->isVisible()) {
         setWindowedMode(false);
         #if !defined(__APPLE__)
@@ -1536,6 +2085,8 @@ void ShijimaManager::tick() {
     #endif
 
     if (m_mascots.size() == 0) {
+        // Nothing left to breed from
+        m_deferredBreeds.clear();
         #if !defined(__APPLE__)
         if (!windowedMode() && (isMinimized() || !m_wasVisible)) {
             setWindowState(windowState() & ~Qt::WindowMinimized);
@@ -1545,67 +2096,158 @@ void ShijimaManager::tick() {
         return;
     }
 
-    updateEnvironment();
+    m_environmentChanged = false;
+    {
+        TickProfiler::Scope scope { m_tickProfiler, TickProfiler::Environment };
+        updateEnvironment();
+    }
+    bool wakeAll = m_environmentChanged;
+
+    // Remove closed mascots. This happens before any index is recorded
+    // since removeAt() moves the last mascot into the freed slot.
+    bool mascotsRemoved = false;
+    for (int i = m_mascots.size() - 1; i >= 0; --i) {
+        ShijimaWidget *shimeji = m_mascots.at(i);
+        if (shimeji->closed() ||
+            (!shimeji->composited() && !shimeji->isVisible()))
+        {
+            for (auto overlay : m_overlays) {
+                overlay->invalidate(shimeji->m_compositedRect);
+            }
+            m_mascotIndex.remove(shimeji);
+            m_windowPool.release(shimeji);
+            m_mascots.removeAt(i);
+            mascotsRemoved = true;
+        }
+    }
 
-    for (auto iter = m_mascots.end(); iter != m_mascots.begin(); ) {
-        --iter;
-        ShijimaWidget *shimeji = *iter;
-        if (!shimeji->isVisible()) {
-            int mascotId = shimeji->mascotId();
-            delete shimeji;
-            auto erasePos = iter;
-            ++iter;
-            m_mascots.erase(erasePos);
-            m_mascotsById.erase(mascotId);
+    // Sort the remaining mascots into simulation lanes
+    bool allAsleep = true;
+    m_tickEntries.clear();
+    for (auto &lane : m_laneMascots) {
+        lane.clear();
+    }
+    m_fallThroughMascots.clear();
+    for (int i = 0; i < m_mascots.size(); ++i) {
+        ShijimaWidget *shimeji = m_mascots.at(i);
+        // Activity level: mascots that have not changed for a while or
+        // that are off-screen sleep and only step once per tick, with
+        // the skipped subticks simulated in one go
+        if (wakeAll || cursorNear(i)) {
+            shimeji->wake();
+        }
+        bool hidden = offScreen(i);
+        bool asleep = !shimeji->mascot().state->dragging &&
+            !shimeji->m_markedForDeletion &&
+            (shimeji->m_stillTicks >= kSleepAfterSubticks || hidden);
+        allAsleep = allAsleep && asleep;
+        if (asleep && !firstSubtick) {
             continue;
         }
-        // --- Fall-through tracking ---
-        // Before tick: if mascot is in fall-through mode, temporarily
-        // lower the floor to the absolute screen bottom (past taskbar).
-        double savedFloorY = 0.0;
-        bool didOverrideFloor = false;
-        if (shimeji->isFallThroughMode()) {
-            savedFloorY = shimeji->env()->floor.y;
-            shimeji->env()->floor.y = shimeji->env()->screen.bottom;
-            shimeji->env()->work_area.bottom = shimeji->env()->screen.bottom;
-            didOverrideFloor = true;
+        shimeji->m_simulationSteps = asleep ? m_tickScheduler.subtickCount() : 1;
+        // A still mascot that starts moving wakes up and gets the rest
+        // of the tick as regular subticks. Moving doesn't wake a hidden
+        // one, so it always runs the whole batch to keep its pace.
+        shimeji->m_stopOnMotion = asleep && !hidden;
+        auto &anchor = shimeji->mascot().state->anchor;
+        m_mascots.anchorBefore(i) = { anchor.x, anchor.y };
+        m_tickEntries.push_back(i);
+        if (m_mascots.fallThrough(i)) {
+            m_fallThroughMascots.push_back(shimeji);
         }
+        else {
+            m_laneMascots[shimeji->m_simulationLane].push_back(shimeji);
+        }
+    }
+
+    m_allAsleep = allAsleep;
+
+    // Time spent on the mascots themselves, always measured unlike the
+    // profiler phases. Fixed costs of a tick are left out so that they
+    // do not look like a per-mascot cost to the population governor.
+    qint64 mascotNsecs = 0;
+    QElapsedTimer mascotTimer;
+    mascotTimer.start();
+    {
+        TickProfiler::Scope scope { m_tickProfiler, TickProfiler::Simulate };
+        simulateMascots();
+    }
+    mascotNsecs += mascotTimer.nsecsElapsed();
+
+    {
+        TickProfiler::Scope scope { m_tickProfiler, TickProfiler::Serial };
+        updateMascotsAfterSimulation();
+        drainDeferredBreeds();
+    }
+
+    // GUI phase: offsets, sounds and paint requests
+    mascotTimer.start();
+    {
+        TickProfiler::Scope scope { m_tickProfiler, TickProfiler::Apply };
+        for (int index : m_tickEntries) {
+            ShijimaWidget *shimeji = m_mascots.at(index);
+            shimeji->applyTick();
+            m_mascots.windowRect(index) = shimeji->windowRect();
+        }
+    }
+    mascotNsecs += mascotTimer.nsecsElapsed();
+    
+    for (auto &env : m_env) {
+        env->reset_scale();
+    }
 
-        double anchorYBefore = shimeji->mascot().state->anchor.y;
-        shimeji->tick();
+    if (m_mascots.size() == 0 && !windowedMode()) {
+        // All mascots self-destructed, show manager
+        setManagerVisible(true);
+    }
 
-        // After tick: restore floor if overridden, then update fall tracking.
-        if (didOverrideFloor) {
-            shimeji->env()->floor.y = savedFloorY;
-            shimeji->env()->work_area.bottom = savedFloorY;
+    {
+        TickProfiler::Scope scope { m_tickProfiler, TickProfiler::Flush };
+        if (m_repaintScheduler.frameDue()) {
+            flushPaints();
+        }
+        else if (mascotsRemoved) {
+            // Overlays only erase a removed mascot when they are flushed.
+            // Without mascots ticks stop, so waiting for the next frame
+            // could leave it on screen for good.
+            compositeMascots();
         }
+        Platform::flushWindowSystem();
+    }
+    m_repaintScheduler.tickFinished();
+    m_populationGovernor.tickFinished(mascotNsecs, m_mascots.size());
+}
+
+// Serial phase of tick(): fall tracking, screen changes and breeding
+void ShijimaManager::updateMascotsAfterSimulation() {
+    for (int index : m_tickEntries) {
+        ShijimaWidget *shimeji = m_mascots.at(index);
 
         // Track falling state for fall-through detection.
         if (!windowedMode()) {
+            double anchorYBefore = m_mascots.anchorBefore(index).y();
             double anchorYAfter = shimeji->mascot().state->anchor.y;
             bool onLand = shimeji->mascot().state->on_land();
             bool isDragging = shimeji->mascot().state->dragging;
 
             // Reset fall-through when mascot is dragged (picked up)
-            if (isDragging && shimeji->isFallThroughMode()) {
-                shimeji->m_fallThroughMode = false;
-                shimeji->m_fallTracking = false;
+            if (isDragging && m_mascots.fallThrough(index)) {
+                m_mascots.setFallThrough(index, false);
             }
 
             if (!onLand && !isDragging && anchorYAfter > anchorYBefore) {
                 // Mascot is falling
-                if (!shimeji->m_fallTracking) {
-                    shimeji->m_fallTracking = true;
-                    shimeji->m_fallStartY = anchorYBefore;
+                if (!m_mascots.fallTracking(index)) {
+                    m_mascots.startFall(index, anchorYBefore);
                 }
-                double fallDistance = anchorYAfter - shimeji->m_fallStartY;
+                double fallDistance = anchorYAfter - m_mascots.fallStartY(index);
                 if (fallDistance >= 700.0) {
-                    shimeji->m_fallThroughMode = true;
+                    m_mascots.setFallThrough(index, true);
                 }
             }
             else {
                 // Not falling (on land, dragging, or moving upward)
-                shimeji->m_fallTracking = false;
+                m_mascots.stopFall(index);
             }
         }
         auto &mascot = shimeji->mascot();
@@ -1619,51 +2261,199 @@ void ShijimaManager::tick() {
             }
         }
         if (breedRequest.available) {
+            TickProfiler::Scope scope { m_tickProfiler, TickProfiler::Breeding };
             if (breedRequest.name == "") {
                 breedRequest.name = shimeji->mascotName().toStdString();
             }
             // only consider the last path component
             breedRequest.name = breedRequest.name.substr(breedRequest.name.rfind('\\')+1);
             breedRequest.name = breedRequest.name.substr(breedRequest.name.rfind('/')+1);
-            std::optional<shijima::mascot::factory::product> product;
-            try {
-                product = m_factory.spawn(breedRequest);
+            // Older deferred requests go first
+            if (m_deferredBreeds.empty() && m_populationGovernor.admit(
+                m_mascots.size()) == PopulationGovernor::Decision::Allow)
+            {
+                breed(breedRequest, shimeji->env());
             }
-            catch (std::exception &ex) {
-                std::cerr << "couldn't fulfill breed request for "
-                    << breedRequest.name << std::endl;
-                std::cerr << ex.what() << std::endl;
+            else if ((int)m_deferredBreeds.size() < PopulationGovernor::kMaxDeferred) {
+                m_deferredBreeds.push_back({ breedRequest, shimeji->env(), {} });
+                m_deferredBreeds.back().age.start();
             }
-            if (product.has_value()) {
-                ShijimaWidget *child = new ShijimaWidget(
-                    m_loadedMascots[QString::fromStdString(breedRequest.name)],
-                    std::move(product->manager), m_idCounter++,
-                    windowedMode(), mascotParent());
-                child->setEnv(shimeji->env());
-                child->show();
-                m_mascots.push_back(child);
-                m_mascotsById[child->mascotId()] = child;
+            else {
+                m_populationGovernor.addDenied();
             }
             breedRequest.available = false;
         }
     }
-    
-    for (auto &env : m_env) {
-        env->reset_scale();
+}
+
+void ShijimaManager::breed(BreedRequest const& request,
+    std::shared_ptr<shijima::mascot::environment> env)
+{
+    if (m_mascots.full()) {
+        // Checked before anything is created, there is nowhere to put
+        // the child
+        m_populationGovernor.addDenied();
+        return;
     }
+    std::optional<shijima::mascot::factory::product> product;
+    int lane = nextSimulationLane();
+    try {
+        product = m_factories[lane]->spawn(request);
+    }
+    catch (std::exception &ex) {
+        std::cerr << "couldn't fulfill breed request for "
+            << request.name << std::endl;
+        std::cerr << ex.what() << std::endl;
+    }
+    if (product.has_value()) {
+        ShijimaWidget *child = createMascot(
+            m_loadedMascots[QString::fromStdString(request.name)],
+            std::move(product->manager));
+        child->m_simulationLane = lane;
+        child->setEnv(env);
+        showMascot(child);
+        m_mascots.insert(child);
+    }
+}
 
-    if (m_mascots.size() == 0 && !windowedMode()) {
-        // All mascots self-destructed, show manager
-        setManagerVisible(true);
+void ShijimaManager::drainDeferredBreeds() {
+    while (!m_deferredBreeds.empty()) {
+        auto &deferred = m_deferredBreeds.front();
+        bool screenAlive = false;
+        for (auto &env : m_env) {
+            screenAlive = screenAlive || env == deferred.env;
+        }
+        if (deferred.age.elapsed() >= PopulationGovernor::kDeferredTimeoutMs ||
+            !screenAlive)
+        {
+            // Too old, or its screen is gone
+            m_populationGovernor.addDenied();
+            m_deferredBreeds.pop_front();
+            continue;
+        }
+        if (m_populationGovernor.admit(m_mascots.size()) !=
+            PopulationGovernor::Decision::Allow)
+        {
+            break;
+        }
+        TickProfiler::Scope scope { m_tickProfiler, TickProfiler::Breeding };
+        breed(deferred.request, deferred.env);
+        m_deferredBreeds.pop_front();
     }
+}
 
-    updateStatusBar();
+void ShijimaManager::dropDeferredBreeds(QString const& name) {
+    auto stdName = name.toStdString();
+    m_deferredBreeds.erase(std::remove_if(m_deferredBreeds.begin(),
+        m_deferredBreeds.end(), [&stdName](DeferredBreed const& deferred) {
+            return deferred.request.name == stdName;
+        }), m_deferredBreeds.end());
+}
+
+bool ShijimaManager::cursorNear(int index) {
+    auto &cursor = m_mascots.at(index)->env()->cursor;
+    QPoint pos { (int)cursor.x, (int)cursor.y };
+    return m_mascots.windowRect(index).adjusted(-kWakeDistance, -kWakeDistance,
+        kWakeDistance, kWakeDistance).contains(pos);
+}
+
+bool ShijimaManager::offScreen(int index) {
+    auto &screen = m_mascots.at(index)->env()->screen;
+    QRect screenRect { QPoint { (int)screen.left, (int)screen.top },
+        QPoint { (int)screen.right, (int)screen.bottom } };
+    return !screenRect.intersects(m_mascots.windowRect(index));
+}
+
+int ShijimaManager::nextSimulationLane() {
+    // Lanes left over from a higher thread count keep their mascots but
+    // get no new ones
+    m_nextLane = (m_nextLane + 1) % m_simulationThreads;
+    return m_nextLane;
+}
+
+int ShijimaManager::maxSimulationThreads() {
+    return std::clamp(QThread::idealThreadCount(), 1, kMaxSimulationThreads);
+}
+
+void ShijimaManager::setSimulationThreads(int threads) {
+    m_simulationThreads = std::clamp(threads, 1, maxSimulationThreads());
+    // Lanes are only ever added: a mascot stays with the factory that
+    // spawned it, and each factory parses every template
+    while ((int)m_factories.size() < m_simulationThreads) {
+        auto factory = std::make_unique<shijima::mascot::factory>();
+        for (auto data : m_loadedMascots) {
+            factory->register_template(templateForData(data));
+        }
+        m_factories.push_back(std::move(factory));
+        m_laneMascots.emplace_back();
+    }
+    // blockingMap() also runs work on the calling thread
+    m_simulationPool.setMaxThreadCount(std::max(m_simulationThreads - 1, 1));
+}
+
+void ShijimaManager::simulateMascots() {
+    // Mascots spawned by the same factory share its scripting context,
+    // so a lane is only ever stepped by one thread.
+    auto simulateLane = [](std::vector<ShijimaWidget *> const& lane) {
+        for (auto mascot : lane) {
+            mascot->simulate();
+        }
+    };
+    if (m_simulationThreads > 1) {
+        // Lanes running in parallel never share an environment: each one
+        // steps its mascots against its own copy of every environment,
+        // refreshed from the live one every tick. Anything the engine
+        // writes to the environment during the tick stays in that copy.
+        m_laneEnvironments.resize(m_laneMascots.size());
+        for (auto &snapshots : m_laneEnvironments) {
+            for (auto &env : m_env) {
+                auto &snapshot = snapshots[env.get()];
+                if (snapshot == nullptr) {
+                    snapshot = std::make_shared<shijima::mascot::environment>(*env);
+                }
+                else {
+                    *snapshot = *env;
+                }
+            }
+        }
+        QtConcurrent::blockingMap(&m_simulationPool, m_laneMascots,
+            [this](std::vector<ShijimaWidget *> const& lane)
+        {
+            auto &snapshots = m_laneEnvironments[&lane - m_laneMascots.data()];
+            for (auto mascot : lane) {
+                auto live = mascot->env();
+                auto snapshot = snapshots.value(live.get());
+                if (snapshot != nullptr) {
+                    mascot->setEnv(snapshot);
+                }
+                mascot->simulate();
+                mascot->setEnv(live);
+            }
+        });
+    }
+    else {
+        for (auto &lane : m_laneMascots) {
+            simulateLane(lane);
+        }
+    }
+
+    // Fall-through mascots temporarily lower the floor of their shared
+    // environment, so they are stepped one at a time afterwards: the
+    // floor goes to the absolute screen bottom (past the taskbar).
+    for (auto shimeji : m_fallThroughMascots) {
+        auto env = shimeji->env();
+        double savedFloorY = env->floor.y;
+        env->floor.y = env->screen.bottom;
+        env->work_area.bottom = env->screen.bottom;
+        shimeji->simulate();
+        env->floor.y = savedFloorY;
+        env->work_area.bottom = savedFloorY;
+    }
 }
 
 ShijimaWidget *ShijimaManager::hitTest(QPoint const& screenPos) {
-    for (auto mascot : m_mascots) {
-        QPoint localPos = { screenPos.x() - mascot->x(),
-            screenPos.y() - mascot->y() };
+    for (auto mascot : m_mascotIndex.at(screenPos)) {
+        QPoint localPos = screenPos - mascot->windowRect().topLeft();
         if (mascot->pointInside(localPos)) {
             return mascot;
         }
@@ -1685,25 +2475,51 @@ QScreen *ShijimaManager::mascotScreen() {
     return screen;
 }
 
+ShijimaWidget *ShijimaManager::createMascot(MascotData *data,
+    std::unique_ptr<shijima::mascot::manager> mascot)
+{
+    if (windowedMode()) {
+        return new ShijimaWidget(data, std::move(mascot), m_mascots.nextId(),
+            true, mascotParent());
+    }
+    return m_windowPool.acquire(data, std::move(mascot), m_mascots.nextId());
+}
+
 ShijimaWidget *ShijimaManager::spawn(std::string const& name) {
+    if (m_mascots.full()) {
+        std::cerr << "couldn't spawn " << name << ": too many mascots"
+            << std::endl;
+        return nullptr;
+    }
     QScreen *screen = mascotScreen();
     updateEnvironment(screen);
     auto &env = m_env[screen];
-    auto product = m_factory.spawn(name, {});
+    int lane = nextSimulationLane();
+    auto product = m_factories[lane]->spawn(name, {});
     product.manager->state->env = env;
     product.manager->reset_position();
-    ShijimaWidget *shimeji = new ShijimaWidget(
+    ShijimaWidget *shimeji = createMascot(
         m_loadedMascots[QString::fromStdString(name)],
-        std::move(product.manager), m_idCounter++,
-        windowedMode(), mascotParent());
-    shimeji->show();
-    m_mascots.push_back(shimeji);
-    m_mascotsById[shimeji->mascotId()] = shimeji;
+        std::move(product.manager));
+    shimeji->m_simulationLane = lane;
+    showMascot(shimeji);
+    m_mascots.insert(shimeji);
     env->reset_scale();
+    wakeTicks();
     return shimeji;
 }
 
 bool ShijimaManager::eventFilter(QObject *obj, QEvent *event) {
+    if (obj == m_sandboxWidget && event->type() == QEvent::Hide) {
+        // Closing the sandbox is handled by tick(), which may not be
+        // running
+        wakeTicks();
+    }
+    if (obj == m_sandboxWidget && (event->type() == QEvent::Move ||
+        event->type() == QEvent::Resize))
+    {
+        invalidateScreenGeometry(nullptr);
+    }
     if (event->type() == QEvent::KeyPress) {
         QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
         auto key = keyEvent->key();
@@ -1718,7 +2534,7 @@ bool ShijimaManager::eventFilter(QObject *obj, QEvent *event) {
 }
 
 void ShijimaManager::spawnClicked() {
-    auto &allTemplates = m_factory.get_all_templates();
+    auto &allTemplates = m_factories.front()->get_all_templates();
     int target = QRandomGenerator::global()->bounded((int)allTemplates.size());
     int i = 0;
     for (auto &pair : allTemplates) {
@@ -1788,6 +2604,10 @@ void ShijimaManager::changeEvent(QEvent *event) {
     if (event->type() == QEvent::LanguageChange && !m_constructing) {
         retranslateUi();
     }
+    else if (event->type() == QEvent::WindowStateChange) {
+        // Minimizing is handled by tick(), which may not be running
+        wakeTicks();
+    }
     PlatformWidget::changeEvent(event);
 }
 
@@ -34,34 +34,39 @@
 #include "shijima-qt/AssetLoader.hpp"
 #include "shijima-qt/ShijimaContextMenu.hpp"
 #include "shijima-qt/ShijimaManager.hpp"
+#include "shijima-qt/SettingsStore.hpp"
 #include "shijima-qt/SpeechBubbleWidget.hpp"
 #if SHIJIMA_WITH_SHIMEJIFINDER
 #include <shimejifinder/utils.hpp>
 #endif
 #include <algorithm>
 #include <cctype>
+#include <climits>
 
 using namespace shijima;
 
+// Mascot ids are slot handles and say nothing about spawn order
+static quint64 s_spawnCounter = 0;
+
 ShijimaWidget::ShijimaWidget(MascotData *mascotData,
     std::unique_ptr<shijima::mascot::manager> mascot,
     int mascotId, bool windowedMode, QWidget *parent):
+    ShijimaWidget(windowedMode, parent)
+{
+    recycle(mascotData, std::move(mascot), mascotId);
+}
+
+ShijimaWidget::ShijimaWidget(bool windowedMode, QWidget *parent):
 #if defined(__APPLE__)
     PlatformWidget(nullptr, PlatformWidget::ShowOnAllDesktops),
 #else
     PlatformWidget(parent, PlatformWidget::ShowOnAllDesktops),
 #endif
-    m_windowedMode(windowedMode), m_data(mascotData),
-    m_inspector(nullptr), m_mascotId(mascotId)
+    m_windowedMode(windowedMode), m_data(nullptr),
+    m_inspector(nullptr), m_mascotId(-1), m_spawnOrder(0)
 {
     m_windowHeight = 128;
     m_windowWidth = 128;
-    m_mascot = std::move(mascot);
-    
-    QDir dir { m_data->imgRoot() };
-    if (dir.exists() && dir.cdUp() && dir.cd("sound")) {
-        m_sounds.searchPaths.push_back(dir.path());
-    }
     
     // Speech bubble click reset timer
     m_clickResetTimer.setSingleShot(true);
@@ -84,14 +89,79 @@ ShijimaWidget::ShijimaWidget(MascotData *mascotData,
         #endif
         setWindowFlags(flags);
     }
+    m_windowRect = { 0, 0, m_windowWidth, m_windowHeight };
     setFixedSize(m_windowWidth, m_windowHeight);
 }
 
-
 ShijimaWidget::ShijimaWidget(ShijimaWidget &old, bool windowedMode,
-    QWidget *parent) : ShijimaWidget(old.mascotData(),
-    std::move(old.m_mascot), old.m_mascotId,
-    windowedMode, parent) {}
+    QWidget *parent) : ShijimaWidget(windowedMode, parent)
+{
+    recycle(old);
+}
+
+void ShijimaWidget::recycle(MascotData *mascotData,
+    std::unique_ptr<shijima::mascot::manager> mascot, int mascotId)
+{
+    m_data = mascotData;
+    m_mascot = std::move(mascot);
+    m_mascotId = mascotId;
+    m_spawnOrder = s_spawnCounter++;
+
+    QList<QString> searchPaths;
+    QDir dir { m_data->imgRoot() };
+    if (dir.exists() && dir.cdUp() && dir.cd("sound")) {
+        searchPaths.push_back(dir.path());
+    }
+    if (searchPaths != m_sounds.searchPaths) {
+        // Effects are cached by name, which may mean another file now
+        m_sounds.clear();
+        m_sounds.searchPaths = searchPaths;
+    }
+
+    // Everything else describes the previous mascot
+    m_imageRect = {};
+    m_anchorInWindow = {};
+    m_drawScale = 1.0;
+    m_drawOrigin = {};
+    m_windowHeight = 128;
+    m_windowWidth = 128;
+    m_visible = false;
+    m_contextMenuVisible = false;
+    m_paused = false;
+    m_markedForDeletion = false;
+    m_composited = false;
+    m_closed = false;
+    m_paintPending = false;
+    m_geometryPending = false;
+    m_compositedRect = {};
+    m_simulated = false;
+    m_previousFrameName.clear();
+    m_previousAnchorX = 0.0;
+    m_previousAnchorY = 0.0;
+    m_stillTicks = 0;
+    m_simulationSteps = 1;
+    m_stopOnMotion = false;
+    m_simulationLane = 0;
+    m_clickResetTimer.stop();
+    m_clickCount = 0;
+    m_windowRect = { 0, 0, m_windowWidth, m_windowHeight };
+    setFixedSize(m_windowWidth, m_windowHeight);
+}
+
+void ShijimaWidget::recycle(ShijimaWidget &old) {
+    recycle(old.mascotData(), std::move(old.m_mascot), old.m_mascotId);
+    m_simulationLane = old.m_simulationLane;
+    m_spawnOrder = old.m_spawnOrder;
+}
+
+void ShijimaWidget::retire() {
+    hide();
+    releaseMascot();
+    m_sounds.stop();
+    m_mascot.reset();
+    m_data = nullptr;
+    m_mascotId = -1;
+}
 
 void ShijimaWidget::showInspector() {
     if (m_inspector == nullptr) {
@@ -106,17 +176,28 @@ bool ShijimaWidget::inspectorVisible() {
 
 Asset const& ShijimaWidget::getActiveAsset() {
     auto &name = m_mascot->state->active_frame.get_name(m_mascot->state->looking_right);
-    std::string lowerName = name;
+    auto loader = AssetLoader::defaultLoader();
+    if (m_frameHandle < 0 || name != m_frameName) {
+        std::string lowerName = name;
 #if SHIJIMA_WITH_SHIMEJIFINDER
-    lowerName = shimejifinder::to_lower(lowerName);
+        lowerName = shimejifinder::to_lower(lowerName);
 #else
-    std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), [](unsigned char c) {
-        return (char)std::tolower(c);
-    });
+        std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), [](unsigned char c) {
+            return (char)std::tolower(c);
+        });
 #endif
-    auto imagePath = QDir::cleanPath(m_data->imgRoot()
-        + QDir::separator() + QString::fromStdString(lowerName));
-    return AssetLoader::defaultLoader()->loadAsset(imagePath);
+        int handle = loader->frameHandle(m_data->id(), m_data->imgRoot(),
+            QString::fromStdString(lowerName));
+        // Keep the frame on screen out of reach of cache eviction
+        loader->pinAsset(m_data->id(), handle);
+        if (m_frameHandle >= 0) {
+            loader->unpinAsset(m_frameTemplate, m_frameHandle);
+        }
+        m_frameName = name;
+        m_frameTemplate = m_data->id();
+        m_frameHandle = handle;
+    }
+    return loader->loadAsset(m_frameTemplate, m_frameHandle);
 }
 
 bool ShijimaWidget::isMirroredRender() const {
@@ -124,41 +205,62 @@ bool ShijimaWidget::isMirroredRender() const {
         m_mascot->state->looking_right;
 }
 
-void ShijimaWidget::paintEvent(QPaintEvent *event) {
+void ShijimaWidget::paintFrame(QPainter &painter, QPoint const& windowOrigin) {
     if (!m_visible) {
         return;
     }
     auto &asset = getActiveAsset();
-    auto &image = asset.image(isMirroredRender());
-    auto scaledSize = image.size() / m_drawScale;
-    QPainter painter(this);
-    if (m_drawScale >= 4.0) {
-        // High shrink ratio: use area-averaging pre-scale for better quality
-        auto preScaled = image.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        painter.drawImage(m_drawOrigin, preScaled);
+    QPoint origin = windowOrigin + m_drawOrigin;
+    if (m_drawScale == 1.0 && !isMirroredRender() && asset.atlas() != nullptr) {
+        auto &slot = asset.atlasSlot();
+        painter.drawImage(origin, asset.atlas()->sheet(slot.sheet),
+            slot.rect());
     }
     else {
-        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
-        painter.drawImage(QRect { m_drawOrigin, scaledSize }, image);
+        // The asset keeps pre-scaled variants around, so this is a plain blit
+        auto &image = asset.scaledImage(isMirroredRender(), m_drawScale);
+        painter.drawImage(origin, image);
+    }
+}
+
+void ShijimaWidget::paintEvent(QPaintEvent *event) {
+    if (!m_visible) {
+        return;
     }
+    TickProfiler::Scope scope { ShijimaManager::defaultManager()->tickProfiler(),
+        TickProfiler::Paint };
+    QPainter painter(this);
+    paintFrame(painter, {});
 #ifdef __linux__
     if (Platform::useWindowMasks()) {
-        m_windowMask = QBitmap::fromPixmap(asset.mask(isMirroredRender())
-            .scaled(scaledSize));
-        m_windowMask.translate(m_drawOrigin);
-        auto bounding = m_windowMask.boundingRect();
+        // Shapes are cached per frame, so most paints only translate a
+        // region. setMask sends a shape request to the X server, skip it
+        // unless the shape actually changed.
+        auto &asset = getActiveAsset();
+        QRegion windowMask = asset.shape(isMirroredRender(), m_drawScale)
+            .translated(m_drawOrigin);
+        auto bounding = windowMask.boundingRect();
         bounding.setTop(0);
         bounding.setLeft(0);
-        if (bounding.width() > 0 && bounding.height() > 0) {
-            setMask(m_windowMask);
+        if (bounding.width() <= 0 || bounding.height() <= 0) {
+            windowMask = QRect { m_windowWidth - 2, m_windowHeight - 2, 1, 1 };
         }
-        else {
-            setMask(QRect { m_windowWidth - 2, m_windowHeight - 2, 1, 1 });
+        if (windowMask != m_windowMask) {
+            m_windowMask = windowMask;
+            setMask(m_windowMask);
+            shapeUpdateCounter().add();
         }
     }
 #endif
 }
 
+#ifdef __linux__
+RateCounter &ShijimaWidget::shapeUpdateCounter() {
+    static RateCounter counter;
+    return counter;
+}
+#endif
+
 bool ShijimaWidget::updateOffsets() {
     bool needsRepaint = false;
     auto &frame = m_mascot->state->active_frame;
@@ -178,12 +280,10 @@ bool ShijimaWidget::updateOffsets() {
 
     if (windowWidth != m_windowWidth) {
         m_windowWidth = windowWidth;
-        setFixedWidth(m_windowWidth);
         needsRepaint = true;
     }
     if (windowHeight != m_windowHeight) {
         m_windowHeight = windowHeight;
-        setFixedHeight(m_windowHeight);
         needsRepaint = true;
     }
 
@@ -240,49 +340,109 @@ bool ShijimaWidget::updateOffsets() {
         needsRepaint = true;
         m_drawScale = scale;
     }
-    move(winX, winY);
+    // The native window is moved and resized together on the next
+    // display frame, see applyGeometry()
+    QRect windowRect { winX, winY, m_windowWidth, m_windowHeight };
+    if (windowRect != m_windowRect) {
+        m_windowRect = windowRect;
+        m_geometryPending = true;
+    }
+    ShijimaManager::defaultManager()->mascotIndex().update(this,
+        m_windowRect);
 
     return needsRepaint;
 }
 
+QRegion ShijimaWidget::inputShape() {
+    if (!m_visible) {
+        return {};
+    }
+    auto &asset = getActiveAsset();
+    return asset.shape(isMirroredRender(), m_drawScale)
+        .translated(m_windowRect.topLeft() + m_drawOrigin);
+}
+
 bool ShijimaWidget::pointInside(QPoint const& point) {
     if (!m_visible) {
         return false;
     }
     auto &asset = getActiveAsset();
-    auto image = asset.image(isMirroredRender());
-    int drawnWidth = (int)(image.width() / m_drawScale);
-    int drawnHeight = (int)(image.height() / m_drawScale);
+    bool mirrored = isMirroredRender();
+    // The frame is drawn at image size / scale (see Asset::scaledImage).
+    // Map the center of the drawn pixel back to the frame pixel it was
+    // sampled from.
+    QSize drawnSize = asset.image(false).size() / m_drawScale;
     auto imagePos = point - m_drawOrigin;
     if (imagePos.x() < 0 || imagePos.y() < 0 ||
-        imagePos.x() > drawnWidth || imagePos.y() > drawnHeight)
+        imagePos.x() >= drawnSize.width() ||
+        imagePos.y() >= drawnSize.height())
     {
         return false;
     }
-    //FIXME: is this position correct?
-    auto color = image.pixelColor(imagePos * m_drawScale);
-    if (color.alpha() == 0) {
-        return false;
-    }
-    return true;
+    auto &image = asset.image(false);
+    int x = std::min((int)((imagePos.x() + 0.5) * m_drawScale),
+        image.width() - 1);
+    int y = std::min((int)((imagePos.y() + 0.5) * m_drawScale),
+        image.height() - 1);
+    return asset.opaqueAt(mirrored, x, y);
 }
 
 void ShijimaWidget::tick() {
+    simulate();
+    applyTick();
+}
+
+void ShijimaWidget::simulate() {
+    m_simulated = false;
+    if (m_markedForDeletion || paused()) {
+        return;
+    }
+    auto &anchor = m_mascot->state->anchor;
+    m_previousFrameName = m_mascot->state->active_frame.name;
+    m_previousAnchorX = anchor.x;
+    m_previousAnchorY = anchor.y;
+    for (int i=0; i<m_simulationSteps; ++i) {
+        m_mascot->tick();
+        // Stop early when a sleeping mascot starts moving again,
+        // applyTick() wakes it up
+        if (m_stopOnMotion &&
+            (anchor.x != m_previousAnchorX || anchor.y != m_previousAnchorY ||
+            m_mascot->state->active_frame.name != m_previousFrameName))
+        {
+            break;
+        }
+    }
+    m_simulated = true;
+}
+
+void ShijimaWidget::applyTick() {
     if (m_markedForDeletion) {
         close();
         return;
     }
-    if (paused()) {
+    if (!m_simulated) {
         return;
     }
+    m_simulated = false;
 
-    // Tick
-    auto prev_frame = m_mascot->state->active_frame;
-    m_mascot->tick();
     auto &new_frame = m_mascot->state->active_frame;
     auto &new_sound = m_mascot->state->active_sound;
-    bool forceRepaint = prev_frame.name != new_frame.name;
-    bool offsetsChanged = updateOffsets();
+    bool forceRepaint = m_previousFrameName != new_frame.name;
+    auto &anchor = m_mascot->state->anchor;
+    if (forceRepaint || anchor.x != m_previousAnchorX ||
+        anchor.y != m_previousAnchorY)
+    {
+        m_stillTicks = 0;
+    }
+    else if (m_stillTicks < INT_MAX) {
+        ++m_stillTicks;
+    }
+    bool offsetsChanged;
+    {
+        TickProfiler::Scope scope { ShijimaManager::defaultManager()->tickProfiler(),
+            TickProfiler::Offsets };
+        offsetsChanged = updateOffsets();
+    }
     if (m_mascot->state->dead) {
         forceRepaint = true;
         new_frame.name = "";
@@ -291,17 +451,27 @@ void ShijimaWidget::tick() {
         markForDeletion();
     }
     if (offsetsChanged || forceRepaint) {
-        repaint();
-        update();
-    }
-    if (m_mascot->state->active_sound_changed) {
-        m_sounds.stop();
-        if (!new_sound.empty()) {
-            m_sounds.play(QString::fromStdString(new_sound));
+        // The manager paints pending mascots once per display frame
+        if (m_paintPending) {
+            ShijimaManager::defaultManager()->repaintScheduler().paintSkipped();
         }
+        m_paintPending = true;
     }
-    else if (!m_sounds.playing()) {
-        m_mascot->state->active_sound.clear();
+    {
+        TickProfiler::Scope scope { ShijimaManager::defaultManager()->tickProfiler(),
+            TickProfiler::Sounds };
+        if (m_mascot->state->active_sound_changed) {
+            m_sounds.stop();
+            if (!new_sound.empty()) {
+                m_sounds.play(QString::fromStdString(new_sound),
+                    m_mascot->state->dragging ?
+                    SoundEffectManager::kInteractionPriority :
+                    SoundEffectManager::kAmbientPriority);
+            }
+        }
+        else if (!m_sounds.playing()) {
+            m_mascot->state->active_sound.clear();
+        }
     }
 
     // Update inspector
@@ -311,7 +481,7 @@ void ShijimaWidget::tick() {
 
     // Update speech bubble position
     if (m_speechBubble != nullptr && m_speechBubble->isActive()) {
-        QPoint anchorPos = mapToGlobal(QPoint(width() / 2, 0));
+        QPoint anchorPos = mapToScreen(QPoint(m_windowRect.width() / 2, 0));
         m_speechBubble->updatePosition(anchorPos);
     }
 }
@@ -328,6 +498,17 @@ void ShijimaWidget::showContextMenu(QPoint const& pos) {
 }
 
 ShijimaWidget::~ShijimaWidget() {
+    releaseMascot();
+}
+
+void ShijimaWidget::releaseMascot() {
+    if (m_frameHandle >= 0) {
+        AssetLoader::defaultLoader()->unpinAsset(m_frameTemplate,
+            m_frameHandle);
+        m_frameHandle = -1;
+        m_frameTemplate = -1;
+        m_frameName.clear();
+    }
     if (m_speechBubble != nullptr) {
         m_speechBubble->hideBubble();
         delete m_speechBubble;
@@ -340,6 +521,7 @@ ShijimaWidget::~ShijimaWidget() {
     if (m_inspector != nullptr) {
         m_inspector->close();
         delete m_inspector;
+        m_inspector = nullptr;
     }
     setDragTarget(nullptr);
 }
@@ -360,8 +542,54 @@ void ShijimaWidget::setDragTarget(ShijimaWidget *target) {
     }
 }
 
+bool ShijimaWidget::applyGeometry() {
+    if (!m_geometryPending) {
+        return false;
+    }
+    m_geometryPending = false;
+    if (geometry() == m_windowRect) {
+        return false;
+    }
+    QSize oldSize = size(), newSize = m_windowRect.size();
+    if (oldSize == newSize) {
+        setGeometry(m_windowRect);
+        return true;
+    }
+    // The size stays fixed so the window manager cannot resize mascots.
+    // The bounds are widened first so that neither bound change resizes
+    // the window on its own, leaving setGeometry() as the only request.
+    setMinimumSize(oldSize.boundedTo(newSize));
+    setMaximumSize(oldSize.expandedTo(newSize));
+    setGeometry(m_windowRect);
+    setMinimumSize(newSize);
+    setMaximumSize(newSize);
+    return true;
+}
+
+QPoint ShijimaWidget::mapToScreen(QPoint const& pos) const {
+    if (m_composited) {
+        return m_windowRect.topLeft() + pos;
+    }
+    return mapToGlobal(pos);
+}
+
+void ShijimaWidget::setComposited(bool composited) {
+    m_composited = composited;
+    m_paintPending = true;
+}
+
+void ShijimaWidget::closeEvent(QCloseEvent *event) {
+    m_closed = true;
+    PlatformWidget::closeEvent(event);
+}
+
 void ShijimaWidget::mousePressEvent(QMouseEvent *event) {
-    auto pos = event->pos();
+    if (!pressAt(event->pos(), event->button())) {
+        event->ignore();
+    }
+}
+
+bool ShijimaWidget::pressAt(QPoint const& pos, Qt::MouseButton button) {
     if (m_dragTarget != nullptr) {
         m_dragTarget->m_mascot->state->dragging = false;
     }
@@ -374,26 +602,28 @@ void ShijimaWidget::mousePressEvent(QMouseEvent *event) {
             envPos = mapToParent(pos);
         }
         else {
-            envPos = mapToGlobal(pos);
+            envPos = mapToScreen(pos);
         }
         ShijimaWidget *target = ShijimaManager::defaultManager()->hitTest(envPos);
         setDragTarget(target);
         if (target == nullptr) {
-            event->ignore();
-            return;
+            return false;
         }
     }
-    if (event->button() == Qt::MouseButton::LeftButton) {
+    m_dragTarget->m_stillTicks = 0;
+    ShijimaManager::defaultManager()->wakeTicks();
+    if (button == Qt::MouseButton::LeftButton) {
         m_dragTarget->m_mascot->state->dragging = true;
         // Record press info for click detection
-        m_lastPressGlobalPos = mapToGlobal(pos);
+        m_lastPressGlobalPos = mapToScreen(pos);
         m_pressElapsedTimer.start();
     }
-    else if (event->button() == Qt::MouseButton::RightButton) {
-        auto screenPos = mapToGlobal(pos);
+    else if (button == Qt::MouseButton::RightButton) {
+        auto screenPos = mapToScreen(pos);
         m_dragTarget->showContextMenu(screenPos);
         setDragTarget(nullptr);
     }
+    return true;
 }
 
 void ShijimaWidget::closeAction() {
@@ -401,15 +631,21 @@ void ShijimaWidget::closeAction() {
 }
 
 void ShijimaWidget::mouseReleaseEvent(QMouseEvent *event) {
+    releaseAt(event->pos(), event->button());
+}
+
+void ShijimaWidget::releaseAt(QPoint const& pos, Qt::MouseButton button) {
     if (m_dragTarget == nullptr) {
         return;
     }
-    if (event->button() == Qt::MouseButton::LeftButton) {
+    if (button == Qt::MouseButton::LeftButton) {
         // Detect click vs drag: small movement + short duration
-        auto releaseGlobalPos = mapToGlobal(event->pos());
+        auto releaseGlobalPos = mapToScreen(pos);
         int distance = (releaseGlobalPos - m_lastPressGlobalPos).manhattanLength();
         qint64 elapsed = m_pressElapsedTimer.elapsed();
         ShijimaWidget *clickTarget = m_dragTarget;
+        clickTarget->m_stillTicks = 0;
+        ShijimaManager::defaultManager()->wakeTicks();
 
         m_dragTarget->m_mascot->state->dragging = false;
         setDragTarget(nullptr);
@@ -426,19 +662,14 @@ void ShijimaWidget::handleClick() {
     m_clickResetTimer.start(500); // Reset click count after 500ms of no clicks
 
     // Trigger speech bubble when click count reaches threshold
-    QSettings bubbleSettings("pixelomer", "Shijima-Qt");
-    int threshold = bubbleSettings.value("speechBubbleClickCount", 1).toInt();
-    if (m_clickCount == threshold) {
+    if (m_clickCount == SettingsStore::defaultStore()->speechBubbleClickCount()) {
         showSpeechBubble();
     }
 }
 
 void ShijimaWidget::showSpeechBubble() {
     // Check if speech bubbles are enabled in settings
-    QSettings settings("pixelomer", "Shijima-Qt");
-    bool enabled = settings.value("speechBubbleEnabled",
-        QVariant::fromValue(true)).toBool();
-    if (!enabled) {
+    if (!SettingsStore::defaultStore()->speechBubbleEnabled()) {
         return;
     }
 
@@ -451,7 +682,7 @@ void ShijimaWidget::showSpeechBubble() {
     }
 
     // Calculate anchor position (top-center of the mascot widget in screen coords)
-    QPoint anchorPos = mapToGlobal(QPoint(width() / 2, 0));
+    QPoint anchorPos = mapToScreen(QPoint(m_windowRect.width() / 2, 0));
 
     m_speechBubble->showBubble(text, anchorPos);
 }
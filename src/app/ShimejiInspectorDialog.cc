@@ -83,7 +83,7 @@ ShimejiInspectorDialog::ShimejiInspectorDialog(ShijimaWidget *parent):
     m_formLayout->setContentsMargins(16, 16, 16, 16);
 
     addRow(tr("Window"), [this](shijima::mascot::manager &mascot){
-        return vecToString(shijimaParent()->pos());
+        return vecToString(shijimaParent()->windowRect().topLeft());
     });
     addRow(tr("Anchor"), [](shijima::mascot::manager &mascot){
         return vecToString(mascot.state->anchor);
@@ -0,0 +1,528 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/SoundBank.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <iostream>
+
+static SoundBank *m_defaultBank = nullptr;
+
+SoundBank *SoundBank::defaultBank() {
+    if (m_defaultBank == nullptr) {
+        m_defaultBank = new SoundBank;
+    }
+    return m_defaultBank;
+}
+
+void SoundBank::finalize() {
+    if (m_defaultBank != nullptr) {
+        delete m_defaultBank;
+        m_defaultBank = nullptr;
+    }
+}
+
+#if SHIJIMA_USE_QTMULTIMEDIA
+
+#include <QAudioDevice>
+#include <QAudioFormat>
+#include <QAudioSink>
+#include <QIODevice>
+#include <QMediaDevices>
+#include <QThread>
+#include <QTimer>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+
+// How much audio the sink buffers, which is also the latency of a sound
+static constexpr int kBufferMs = 60;
+
+// The sink is suspended after this long without voices
+static constexpr int kIdleSuspendMs = 2000;
+
+// Pulls mixed audio from the bank. Lives on the audio thread.
+class SoundMixerDevice : public QIODevice {
+public:
+    SoundMixerDevice(SoundBank *bank, int bytesPerSample):
+        m_bank(bank), m_bytesPerSample(bytesPerSample) {}
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override {
+        // The mixer always has data, silence if nothing plays
+        return (qint64)m_bank->m_sampleRate * m_bank->m_channels *
+            m_bytesPerSample + QIODevice::bytesAvailable();
+    }
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *, qint64) override { return -1; }
+private:
+    SoundBank *m_bank;
+    int m_bytesPerSample;
+    std::vector<float> m_buffer;
+};
+
+qint64 SoundMixerDevice::readData(char *data, qint64 maxSize) {
+    int channels = m_bank->m_channels;
+    qint64 frames = maxSize / (channels * m_bytesPerSample);
+    if (frames <= 0) {
+        return 0;
+    }
+    m_buffer.resize(frames * channels);
+    m_bank->mix(m_buffer.data(), frames);
+    qint64 count = frames * channels;
+    switch (m_bank->m_sampleFormat) {
+        case QAudioFormat::Float:
+            std::memcpy(data, m_buffer.data(), count * sizeof(float));
+            break;
+        case QAudioFormat::Int16: {
+            auto out = reinterpret_cast<qint16 *>(data);
+            for (qint64 i=0; i<count; ++i) {
+                out[i] = (qint16)(m_buffer[i] * 32767.f);
+            }
+            break;
+        }
+        case QAudioFormat::Int32: {
+            auto out = reinterpret_cast<qint32 *>(data);
+            for (qint64 i=0; i<count; ++i) {
+                out[i] = (qint32)(m_buffer[i] * 2147483520.f);
+            }
+            break;
+        }
+        default: {
+            auto out = reinterpret_cast<quint8 *>(data);
+            for (qint64 i=0; i<count; ++i) {
+                out[i] = (quint8)(m_buffer[i] * 127.f + 128.f);
+            }
+            break;
+        }
+    }
+    return frames * channels * m_bytesPerSample;
+}
+
+SoundBank::SoundBank() {
+    m_pool.setMaxThreadCount(1);
+    auto device = QMediaDevices::defaultAudioOutput();
+    auto format = device.preferredFormat();
+    format.setSampleFormat(QAudioFormat::Float);
+    if (!device.isFormatSupported(format)) {
+        format.setSampleFormat(QAudioFormat::Int16);
+        if (!device.isFormatSupported(format)) {
+            format = device.preferredFormat();
+        }
+    }
+    m_sampleRate = format.sampleRate();
+    m_channels = format.channelCount();
+    m_sampleFormat = format.sampleFormat();
+    if (m_sampleRate <= 0 || m_channels <= 0) {
+        std::cerr << "SoundBank: no usable audio output" << std::endl;
+        m_sampleRate = 0;
+        m_channels = 0;
+    }
+}
+
+SoundBank::~SoundBank() {
+    m_pool.clear();
+    m_pool.waitForDone();
+    if (m_thread != nullptr) {
+        QMetaObject::invokeMethod(m_context, [this]() {
+            m_sink->stop();
+            delete m_sink;
+            delete m_device;
+        }, Qt::BlockingQueuedConnection);
+        m_thread->quit();
+        m_thread->wait();
+        delete m_context;
+        delete m_thread;
+    }
+}
+
+void SoundBank::startOutput() {
+    m_outputStarted = true;
+    QAudioFormat format;
+    format.setSampleRate(m_sampleRate);
+    format.setChannelCount(m_channels);
+    format.setSampleFormat((QAudioFormat::SampleFormat)m_sampleFormat);
+    auto device = QMediaDevices::defaultAudioOutput();
+    m_thread = new QThread;
+    m_thread->setObjectName("SoundBank");
+    m_thread->start();
+    m_context = new QObject;
+    m_context->moveToThread(m_thread);
+    QMetaObject::invokeMethod(m_context, [this, device, format]() {
+        m_device = new SoundMixerDevice(this, format.bytesPerSample());
+        m_device->open(QIODevice::ReadOnly);
+        m_sink = new QAudioSink(device, format);
+        m_sink->setBufferSize(format.bytesForDuration(kBufferMs * 1000));
+        m_sink->start(m_device);
+        auto idleTimer = new QTimer(m_context);
+        QObject::connect(idleTimer, &QTimer::timeout, m_context, [this]() {
+            // Decided under the command lock, so a voice posted meanwhile
+            // either keeps the output running or resumes it
+            std::lock_guard<std::mutex> lock { m_commandMutex };
+            if (m_suspended || !m_commands.empty()) {
+                return;
+            }
+            for (auto &serial : m_slotSerials) {
+                if (serial != 0) {
+                    return;
+                }
+            }
+            m_suspended = true;
+            m_sink->suspend();
+        });
+        idleTimer->start(kIdleSuspendMs);
+    }, Qt::QueuedConnection);
+}
+
+// Reads a RIFF WAVE file into interleaved float frames
+static bool readWav(QByteArray const& bytes, int &channels, int &rate,
+    std::vector<float> &frames)
+{
+    auto data = reinterpret_cast<const uchar *>(bytes.constData());
+    qsizetype size = bytes.size();
+    if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 ||
+        std::memcmp(data + 8, "WAVE", 4) != 0)
+    {
+        return false;
+    }
+    int tag = 0, bits = 0;
+    channels = 0;
+    rate = 0;
+    const uchar *pcm = nullptr;
+    qsizetype pcmSize = 0;
+    qsizetype offset = 12;
+    while (offset + 8 <= size) {
+        auto chunkSize = (qsizetype)qFromLittleEndian<quint32>(data + offset + 4);
+        auto body = data + offset + 8;
+        chunkSize = std::min(chunkSize, size - offset - 8);
+        if (std::memcmp(data + offset, "fmt ", 4) == 0 && chunkSize >= 16) {
+            tag = qFromLittleEndian<quint16>(body);
+            channels = qFromLittleEndian<quint16>(body + 2);
+            rate = (int)qFromLittleEndian<quint32>(body + 4);
+            bits = qFromLittleEndian<quint16>(body + 14);
+            if (tag == 0xFFFE && chunkSize >= 26) {
+                // WAVE_FORMAT_EXTENSIBLE, the format is in the sub format
+                tag = qFromLittleEndian<quint16>(body + 24);
+            }
+        }
+        else if (std::memcmp(data + offset, "data", 4) == 0) {
+            pcm = body;
+            pcmSize = chunkSize;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    if (pcm == nullptr || channels <= 0 || rate <= 0) {
+        return false;
+    }
+    bool isFloat = tag == 3 && bits == 32;
+    bool isInt = tag == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+    if (!isFloat && !isInt) {
+        return false;
+    }
+    int bytesPerSample = bits / 8;
+    qsizetype count = pcmSize / bytesPerSample;
+    count -= count % channels;
+    frames.resize(count);
+    for (qsizetype i=0; i<count; ++i) {
+        auto sample = pcm + i * bytesPerSample;
+        float value;
+        if (isFloat) {
+            value = qFromLittleEndian<float>(sample);
+        }
+        else if (bits == 8) {
+            value = (sample[0] - 128) / 128.f;
+        }
+        else if (bits == 16) {
+            value = qFromLittleEndian<qint16>(sample) / 32768.f;
+        }
+        else if (bits == 24) {
+            qint32 v = (qint32)((quint32)sample[0] << 8 |
+                (quint32)sample[1] << 16 | (quint32)sample[2] << 24) >> 8;
+            value = v / 8388608.f;
+        }
+        else {
+            value = qFromLittleEndian<qint32>(sample) / 2147483648.f;
+        }
+        frames[i] = value;
+    }
+    return true;
+}
+
+std::shared_ptr<const SoundBank::Sample> SoundBank::decode(QString const& path) {
+    QFile file { path };
+    if (m_channels == 0 || !file.open(QFile::ReadOnly)) {
+        return nullptr;
+    }
+    int channels, rate;
+    std::vector<float> source;
+    if (!readWav(file.readAll(), channels, rate, source)) {
+        std::cerr << "Could not decode effect: " << path.toStdString()
+            << std::endl;
+        return nullptr;
+    }
+    // Remap channels and resample linearly to the mixer format
+    auto sample = std::make_shared<Sample>();
+    size_t sourceFrames = source.size() / channels;
+    double step = (double)rate / m_sampleRate;
+    size_t frames = sourceFrames == 0 ? 0 :
+        (size_t)std::floor((sourceFrames - 1) / step) + 1;
+    sample->data.resize(frames * m_channels);
+    auto at = [&](size_t frame, int channel) {
+        if (channels == 1) {
+            return source[frame];
+        }
+        if (m_channels == 1) {
+            float sum = 0.f;
+            for (int c=0; c<channels; ++c) {
+                sum += source[frame * channels + c];
+            }
+            return sum / channels;
+        }
+        return source[frame * channels + std::min(channel, channels - 1)];
+    };
+    for (size_t i=0; i<frames; ++i) {
+        double position = i * step;
+        size_t frame = (size_t)position;
+        size_t next = std::min(frame + 1, sourceFrames - 1);
+        float t = (float)(position - frame);
+        for (int c=0; c<m_channels; ++c) {
+            sample->data[i * m_channels + c] = at(frame, c) * (1.f - t) +
+                at(next, c) * t;
+        }
+    }
+    return sample;
+}
+
+std::shared_ptr<const SoundBank::Sample> SoundBank::sample(QString const& path) {
+    {
+        std::lock_guard<std::mutex> lock { m_sampleMutex };
+        if (m_samples.contains(path)) {
+            return m_samples[path];
+        }
+        if (m_failed.contains(path)) {
+            return nullptr;
+        }
+    }
+    auto decoded = decode(path);
+    std::lock_guard<std::mutex> lock { m_sampleMutex };
+    if (m_samples.contains(path)) {
+        // Decoded by the preloader in the meantime
+        return m_samples[path];
+    }
+    if (decoded == nullptr) {
+        m_failed.insert(path);
+        return nullptr;
+    }
+    m_samples[path] = decoded;
+    ++m_sampleCount;
+    m_decodedBytes += (qint64)(decoded->data.size() * sizeof(float));
+    return decoded;
+}
+
+void SoundBank::preload(QString const& directory) {
+    if (m_channels == 0) {
+        return;
+    }
+    QStringList paths;
+    QDir dir { directory };
+    for (auto &info : dir.entryInfoList(QDir::Files)) {
+        if (info.suffix().compare("wav", Qt::CaseInsensitive) == 0) {
+            paths.append(info.absoluteFilePath());
+        }
+    }
+    if (paths.isEmpty()) {
+        return;
+    }
+    m_pool.start([this, paths]() {
+        for (auto &path : paths) {
+            sample(path);
+        }
+    });
+}
+
+quint64 SoundBank::play(QString const& path, int priority) {
+    auto decoded = sample(QFileInfo { path }.absoluteFilePath());
+    if (decoded == nullptr || decoded->data.empty()) {
+        return 0;
+    }
+    // Find a free slot and the least important voice, the oldest among
+    // equals, in case there is none
+    int busy = 0, freeSlot = -1, victim = -1;
+    quint64 victimSerial = 0;
+    for (int i=0; i<kMaxVoices; ++i) {
+        quint64 serial = m_slotSerials[i];
+        if (serial == 0) {
+            if (freeSlot == -1) {
+                freeSlot = i;
+            }
+            continue;
+        }
+        ++busy;
+        if (victim == -1 || m_slotPriorities[i] < m_slotPriorities[victim] ||
+            (m_slotPriorities[i] == m_slotPriorities[victim] &&
+            serial < victimSerial))
+        {
+            victim = i;
+            victimSerial = serial;
+        }
+    }
+    int slot = freeSlot;
+    if (busy >= m_voiceLimit) {
+        if (victim == -1 || m_slotPriorities[victim] > priority) {
+            return 0;
+        }
+        slot = victim;
+        ++m_stolenVoices;
+    }
+    quint64 serial = m_nextSerial++;
+    m_slotSerials[slot] = serial;
+    m_slotPriorities[slot] = priority;
+    post({ slot, serial, std::move(decoded) });
+    return serial * kMaxVoices + slot;
+}
+
+bool SoundBank::playing(quint64 voice) const {
+    return voice != 0 &&
+        m_slotSerials[voice % kMaxVoices] == voice / kMaxVoices;
+}
+
+void SoundBank::stop(quint64 voice) {
+    if (voice == 0) {
+        return;
+    }
+    int slot = (int)(voice % kMaxVoices);
+    quint64 serial = voice / kMaxVoices;
+    if (m_slotSerials[slot].compare_exchange_strong(serial, 0)) {
+        post({ slot, serial, nullptr });
+    }
+}
+
+void SoundBank::post(Command const& command) {
+    bool resume;
+    {
+        std::lock_guard<std::mutex> lock { m_commandMutex };
+        m_commands.push_back(command);
+        resume = m_suspended;
+        m_suspended = false;
+    }
+    if (!m_outputStarted) {
+        startOutput();
+    }
+    else if (resume) {
+        QMetaObject::invokeMethod(m_context, [this]() {
+            m_sink->resume();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void SoundBank::mix(float *out, qint64 frames) {
+    QElapsedTimer timer;
+    timer.start();
+    // Never wait for the GUI thread here. Commands that can not be
+    // picked up now are picked up with the next buffer.
+    if (m_commandMutex.try_lock()) {
+        m_mixerCommands.swap(m_commands);
+        m_commandMutex.unlock();
+    }
+    for (auto &command : m_mixerCommands) {
+        auto &voice = m_voices[command.slot];
+        if (command.sample != nullptr) {
+            voice.sample = std::move(command.sample);
+            voice.position = 0;
+            voice.serial = command.serial;
+        }
+        else if (voice.serial == command.serial) {
+            voice.sample.reset();
+            voice.serial = 0;
+        }
+    }
+    m_mixerCommands.clear();
+
+    size_t count = (size_t)frames * m_channels;
+    std::fill(out, out + count, 0.f);
+    for (int slot=0; slot<kMaxVoices; ++slot) {
+        auto &voice = m_voices[slot];
+        if (voice.sample == nullptr) {
+            continue;
+        }
+        auto &data = voice.sample->data;
+        size_t n = std::min(count, data.size() - voice.position);
+        const float *in = data.data() + voice.position;
+        for (size_t i=0; i<n; ++i) {
+            out[i] += in[i];
+        }
+        voice.position += n;
+        if (voice.position >= data.size()) {
+            // Frees the slot unless the GUI thread already reused it
+            quint64 serial = voice.serial;
+            m_slotSerials[slot].compare_exchange_strong(serial, 0);
+            voice.sample.reset();
+            voice.serial = 0;
+        }
+    }
+    // Overlapping voices can add up past full scale. Clip here so that
+    // float devices, which take the mix as is, never see samples out of
+    // range either.
+    for (size_t i=0; i<count; ++i) {
+        out[i] = std::clamp(out[i], -1.f, 1.f);
+    }
+    m_mixNsecs += timer.nsecsElapsed();
+}
+
+#else
+
+SoundBank::SoundBank() {}
+SoundBank::~SoundBank() {}
+void SoundBank::startOutput() {}
+void SoundBank::preload(QString const&) {}
+quint64 SoundBank::play(QString const&, int) { return 0; }
+bool SoundBank::playing(quint64) const { return false; }
+void SoundBank::stop(quint64) {}
+void SoundBank::post(Command const&) {}
+void SoundBank::mix(float *, qint64) {}
+
+#endif
+
+void SoundBank::setVoiceLimit(int limit) {
+    // Extra voices finish on their own
+    m_voiceLimit = std::clamp(limit, 1, kMaxVoices);
+}
+
+SoundBank::Statistics SoundBank::statistics() {
+    if (!m_loadTimer.isValid()) {
+        m_loadTimer.start();
+    }
+    else if (m_loadTimer.elapsed() >= 1000) {
+        qint64 mixNsecs = m_mixNsecs;
+        m_mixerLoad = (double)(mixNsecs - m_lastMixNsecs) /
+            m_loadTimer.nsecsElapsed();
+        m_lastMixNsecs = mixNsecs;
+        m_loadTimer.start();
+    }
+    int activeVoices = 0;
+    for (auto &serial : m_slotSerials) {
+        if (serial != 0) {
+            ++activeVoices;
+        }
+    }
+    return { m_sampleCount, m_decodedBytes, activeVoices, m_stolenVoices,
+        m_mixerLoad };
+}
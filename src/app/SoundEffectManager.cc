@@ -17,64 +17,64 @@
 // 
 
 #include "shijima-qt/SoundEffectManager.hpp"
+#include "shijima-qt/SoundBank.hpp"
 
 #if SHIJIMA_USE_QTMULTIMEDIA
 
 #include <QFile>
 #include <QDir>
+#include <QFileInfo>
 #include <iostream>
-#include <QSoundEffect>
 
-void SoundEffectManager::play(QString const& name) {
-    if (!m_loadedEffects.contains(name)) {
-        QUrl url;
+void SoundEffectManager::play(QString const& name, int priority) {
+    if (!m_paths.contains(name)) {
+        QString path;
         for (QString &searchPath : searchPaths) {
             QString file = QDir::cleanPath(searchPath + QDir::separator() + name);
             if (QFile::exists(file)) {
-                url = QUrl::fromLocalFile(file);
+                path = QFileInfo(file).absoluteFilePath();
                 break;
             }
         }
-        if (url.isEmpty()) {
+        if (path.isEmpty()) {
             std::cerr << "Could not load effect: " << name.toStdString() << std::endl;
-            return;
         }
-        QSoundEffect *effect = m_loadedEffects[name] = new QSoundEffect;
-        effect->setSource(url);
-        effect->setLoopCount(1);
-        effect->setVolume(1.f);
+        // Missing files are remembered too, so the lookup happens once
+        m_paths[name] = path;
     }
     stop();
-    QSoundEffect *effect = m_loadedEffects[name];
-    effect->play();
-    m_activeEffect = effect;
+    QString const& path = m_paths[name];
+    if (!path.isEmpty()) {
+        m_voice = SoundBank::defaultBank()->play(path, priority);
+    }
 }
 
 bool SoundEffectManager::playing() const {
-    if (m_activeEffect != nullptr) {
-        return m_activeEffect->isPlaying();
-    }
-    return false;
+    return SoundBank::defaultBank()->playing(m_voice);
 }
 
 void SoundEffectManager::stop() {
-    if (m_activeEffect != nullptr) {
-        m_activeEffect->stop();
-        m_activeEffect = nullptr;
+    if (m_voice != 0) {
+        SoundBank::defaultBank()->stop(m_voice);
+        m_voice = 0;
     }
 }
 
+void SoundEffectManager::clear() {
+    stop();
+    m_paths.clear();
+}
+
 SoundEffectManager::~SoundEffectManager() {
-    for (QSoundEffect *effect : m_loadedEffects) {
-        delete effect;
-    }
+    stop();
 }
 
 #else
 
-void SoundEffectManager::play(QString const&) {}
+void SoundEffectManager::play(QString const&, int) {}
 bool SoundEffectManager::playing() const { return true; }
 void SoundEffectManager::stop() {}
+void SoundEffectManager::clear() {}
 SoundEffectManager::~SoundEffectManager() {}
 
 #endif
@@ -0,0 +1,122 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/TickProfiler.hpp"
+#include <algorithm>
+
+TickProfiler::Scope::Scope(TickProfiler &profiler, Phase phase):
+    m_profiler(profiler), m_phase(phase)
+{
+    if (m_profiler.m_enabled) {
+        m_timer.start();
+    }
+}
+
+TickProfiler::Scope::~Scope() {
+    if (m_timer.isValid()) {
+        m_profiler.record(m_phase, m_timer.nsecsElapsed());
+    }
+}
+
+char const *TickProfiler::phaseName(Phase phase) {
+    switch (phase) {
+        case Tick: return "tick";
+        case Callbacks: return "callbacks";
+        case Environment: return "environment";
+        case WindowObserver: return "window_observer";
+        case Simulate: return "simulate";
+        case Serial: return "serial";
+        case Breeding: return "breeding";
+        case Apply: return "apply";
+        case Offsets: return "offsets";
+        case Sounds: return "sounds";
+        case Flush: return "flush";
+        case Paint: return "paint";
+        default: return "?";
+    }
+}
+
+void TickProfiler::setEnabled(bool enabled) {
+    if (enabled == m_enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    if (enabled) {
+        m_history.assign((size_t)PhaseCount * kWindowTicks, 0);
+    }
+    else {
+        // Only needed while profiling
+        m_history = {};
+    }
+    m_historyPos = 0;
+    m_historyCount = 0;
+    m_current.fill(0);
+}
+
+void TickProfiler::reset() {
+    m_ticks = 0;
+    m_total.fill(0);
+    m_samples.fill(0);
+    m_current.fill(0);
+    m_historyPos = 0;
+    m_historyCount = 0;
+}
+
+void TickProfiler::record(Phase phase, qint64 nsecs) {
+    m_total[phase] += nsecs;
+    ++m_samples[phase];
+    m_current[phase] += nsecs;
+    if (phase == Tick) {
+        finishTick();
+    }
+}
+
+void TickProfiler::finishTick() {
+    ++m_ticks;
+    if (m_history.empty()) {
+        return;
+    }
+    for (int i=0; i<PhaseCount; ++i) {
+        m_history[(size_t)i * kWindowTicks + m_historyPos] = m_current[i];
+    }
+    m_current.fill(0);
+    m_historyPos = (m_historyPos + 1) % kWindowTicks;
+    m_historyCount = std::min(m_historyCount + 1, kWindowTicks);
+}
+
+TickProfiler::PhaseStatistics TickProfiler::statistics(Phase phase) const {
+    PhaseStatistics stats;
+    if (m_historyCount == 0) {
+        return stats;
+    }
+    // Entries in the ring are unordered anyway, only the count matters
+    auto begin = m_history.begin() + (size_t)phase * kWindowTicks;
+    std::vector<qint64> sorted { begin, begin + m_historyCount };
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        size_t rank = (size_t)(p * (sorted.size() - 1) + 0.5);
+        return sorted[rank] / 1000.0;
+    };
+    stats.ticks = m_historyCount;
+    stats.p50 = percentile(0.50);
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    stats.max = sorted.back() / 1000.0;
+    return stats;
+}
@@ -0,0 +1,93 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "shijima-qt/TickScheduler.hpp"
+#include <algorithm>
+
+void TickScheduler::setSubtickCount(int count) {
+    count = std::clamp(count, 1, kMaxSubtickCount);
+    m_subtickCount = count;
+    m_interval = kTickNsecs / count;
+    if (m_clock.isValid()) {
+        m_nextSubtick = m_clock.nsecsElapsed() + m_interval;
+    }
+}
+
+int TickScheduler::subticksDue() {
+    if (!m_clock.isValid()) {
+        m_clock.start();
+        m_nextSubtick = 0;
+    }
+    qint64 now = m_clock.nsecsElapsed();
+    if (now < m_nextSubtick) {
+        return 0;
+    }
+    qint64 lateness = now - m_nextSubtick;
+    recordLateness(lateness);
+    qint64 due = 1 + lateness / m_interval;
+    if (due > m_subtickCount) {
+        // Catching up on a long stall would only cause the next one
+        int dropped = (int)(due - m_subtickCount);
+        m_dropped.add(dropped);
+        m_droppedTotal += dropped;
+        m_nextSubtick = now + m_interval;
+        return m_subtickCount;
+    }
+    m_nextSubtick += due * m_interval;
+    return (int)due;
+}
+
+int TickScheduler::msUntilNextSubtick() const {
+    if (!m_clock.isValid()) {
+        return 0;
+    }
+    qint64 remaining = m_nextSubtick - m_clock.nsecsElapsed();
+    if (remaining <= 0) {
+        return 0;
+    }
+    return (int)((remaining + 999999) / 1000000);
+}
+
+void TickScheduler::skipSubticks(int count) {
+    m_nextSubtick += count * m_interval;
+}
+
+void TickScheduler::restart() {
+    if (m_clock.isValid()) {
+        m_nextSubtick = m_clock.nsecsElapsed();
+    }
+}
+
+void TickScheduler::recordLateness(qint64 nsecs) {
+    m_latenessSum += nsecs;
+    m_latenessMax = std::max(m_latenessMax, nsecs);
+    ++m_latenessCount;
+    if (!m_statsTimer.isValid()) {
+        m_statsTimer.start();
+        return;
+    }
+    if (m_statsTimer.elapsed() >= 1000) {
+        m_jitterMs = m_latenessSum / 1e6 / m_latenessCount;
+        m_maxJitterMs = m_latenessMax / 1e6;
+        m_latenessSum = 0;
+        m_latenessMax = 0;
+        m_latenessCount = 0;
+        m_statsTimer.start();
+    }
+}
@@ -626,11 +626,112 @@ static int cliMain(int argc, char **argv) {
             return notRunning();
         }
     }
+    else if (action == "stats") {
+        QVariant json { false }, enable { false }, disable { false };
+        if (!parseOptions(argc, argv, {
+            { "json", "Print the API response as JSON", &json, QMetaType::Bool, false },
+            { "enable", "Turn the tick profiler on", &enable, QMetaType::Bool, false },
+            { "disable", "Turn the tick profiler off", &disable, QMetaType::Bool, false }
+        })) {
+            return EXIT_FAILURE;
+        }
+        if (enable.toBool() && disable.toBool()) {
+            cerr << "ERROR: --enable and --disable cannot be used together." <<
+                std::endl;
+            return EXIT_FAILURE;
+        }
+        httplib::Result res;
+        if (enable.toBool() || disable.toBool()) {
+            QJsonObject obj;
+            obj["enabled"] = enable.toBool();
+            QJsonDocument doc { obj };
+            auto bytes = doc.toJson(QJsonDocument::Compact);
+            res = client.Put("/shijima/api/v1/stats",
+                std::string { &bytes[0], (size_t)bytes.size() },
+                "application/json");
+        }
+        else {
+            res = client.Get("/shijima/api/v1/stats");
+        }
+        if (!res) {
+            return notRunning();
+        }
+        QJsonObject object;
+        if (!parseAPIResult(res, object)) {
+            if (json.toBool() && object.contains("error")) {
+                cout << res->body << std::endl;
+            }
+            return EXIT_FAILURE;
+        }
+        if (json.toBool()) {
+            cout << res->body << std::endl;
+            return EXIT_SUCCESS;
+        }
+        auto stats = object["stats"].toObject();
+        auto scheduler = stats["scheduler"].toObject();
+        cout << "Tick jitter: " << scheduler["jitter_ms"].toDouble()
+            << " ms (max " << scheduler["max_jitter_ms"].toDouble()
+            << " ms), " << scheduler["dropped_subticks_per_s"].toDouble()
+            << " dropped subticks/s, " << scheduler["timer_wakeups_per_s"].toDouble()
+            << " timer wakeups/s" << std::endl;
+        cout << "Paints: " << scheduler["skipped_paints_per_tick"].toDouble()
+            << " skipped/tick, " << scheduler["geometry_requests_per_s"].toDouble()
+            << " geometry requests/s, " << scheduler["shape_updates_per_s"].toDouble()
+            << " shape updates/s" << std::endl;
+        auto population = stats["population"].toObject();
+        int cap = population["cap"].toInt();
+        cout << "Population: cap " << (cap == -1 ? std::string { "none" } :
+            std::to_string(cap)) << ", " << population["queued"].toInt()
+            << " queued, " << (qint64)population["denied"].toDouble()
+            << " denied, " << population["mascot_cost_ms"].toDouble()
+            << " ms/mascot" << std::endl;
+        auto pool = stats["window_pool"].toObject();
+        cout << "Window pool: " << pool["idle"].toInt() << "/"
+            << pool["size"].toInt() << " idle, "
+            << (qint64)pool["hits"].toDouble() << " hits, "
+            << (qint64)pool["misses"].toDouble() << " misses" << std::endl;
+        auto sounds = stats["sounds"].toObject();
+        cout << "Sounds: " << sounds["samples"].toInt() << " decoded ("
+            << (qint64)sounds["decoded_bytes"].toDouble() / 1024 << " KiB), "
+            << sounds["voices"].toInt() << "/" << sounds["voice_limit"].toInt()
+            << " voices, " << (qint64)sounds["stolen"].toDouble() << " stolen, "
+            << "mixer load " << sounds["mixer_load"].toDouble() * 100.0 << "%"
+            << std::endl;
+        if (!stats["enabled"].toBool()) {
+            cout << "Tick profiler is off. Turn it on with --enable." << std::endl;
+            return EXIT_SUCCESS;
+        }
+        auto phases = stats["phases"].toObject();
+        cout << QString("phase").leftJustified(18).toStdString()
+            << QString("p50 us").rightJustified(12).toStdString()
+            << QString("p95 us").rightJustified(12).toStdString()
+            << QString("p99 us").rightJustified(12).toStdString()
+            << QString("max us").rightJustified(12).toStdString()
+            << std::endl;
+        static const char *order[] = { "tick", "callbacks", "environment",
+            "window_observer", "simulate", "serial", "breeding", "apply",
+            "offsets", "sounds", "flush", "paint" };
+        for (auto name : order) {
+            if (!phases.contains(name)) {
+                continue;
+            }
+            auto phase = phases[name].toObject();
+            cout << QString(name).leftJustified(18).toStdString();
+            for (auto key : { "p50_us", "p95_us", "p99_us", "max_us" }) {
+                cout << QString::number(phase[key].toDouble(), 'f', 1)
+                    .rightJustified(12).toStdString();
+            }
+            cout << std::endl;
+        }
+        cout << "Over the last " << phases["tick"].toObject()["ticks"].toInt()
+            << " ticks" << std::endl;
+        return EXIT_SUCCESS;
+    }
     else {
         cerr << "Usage: " << argv[0] << " [--quiet] <command> [options...]"
             << std::endl;
         cerr << "   Possible commands are: list, list-loaded, spawn, "
-            "alter, dismiss, dismiss-all" << std::endl;
+            "alter, dismiss, dismiss-all, stats" << std::endl;
         return EXIT_FAILURE;
     }
     return EXIT_SUCCESS;
@@ -25,6 +25,8 @@
 #include "Platform/Platform.hpp"
 #include "shijima-qt/ShijimaManager.hpp"
 #include "shijima-qt/AssetLoader.hpp"
+#include "shijima-qt/SettingsStore.hpp"
+#include "shijima-qt/SoundBank.hpp"
 #include "shijima-qt/cli.hpp"
 #include <httplib.h>
 #include "ElaApplication.h"
@@ -81,5 +83,7 @@ int main(int argc, char **argv) {
     int ret = app.exec();
     ShijimaManager::finalize();
     AssetLoader::finalize();
+    SoundBank::finalize();
+    SettingsStore::finalize();
     return ret;
 }
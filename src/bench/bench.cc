@@ -0,0 +1,452 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+// Headless benchmark for the mascot tick loop. Runs ShijimaManager under
+// the offscreen QPA platform, so it works on machines without a display:
+//
+//   neurolingsce_bench --mascots 200 --ticks 2000
+//
+// With --idle the mascot timer then runs on its own, like in the app,
+// to measure what an idle desktop costs:
+//
+//   neurolingsce_bench --mascots 20 --ticks 1 --hit-tests 0 --idle 30
+//
+// Settings and mascot data go to Qt's test locations, the user's own
+// configuration is never touched.
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QScreen>
+#include <QStandardPaths>
+#include <QTimer>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include "shijima-qt/ShijimaManager.hpp"
+#include "shijima-qt/AssetLoader.hpp"
+#include "shijima-qt/SettingsStore.hpp"
+#include "shijima-qt/SoundBank.hpp"
+#include "ElaApplication.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+// Peak resident set size in bytes, or -1 if unknown
+static qint64 peakResidentSize() {
+#if defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return (qint64)usage.ru_maxrss;
+    }
+#elif defined(__unix__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return (qint64)usage.ru_maxrss * 1024;
+    }
+#endif
+    return -1;
+}
+
+// Current resident set size in bytes, or -1 if unknown
+static qint64 residentSize() {
+#if defined(__linux__)
+    QFile statm { "/proc/self/statm" };
+    if (statm.open(QIODevice::ReadOnly)) {
+        auto fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+        }
+    }
+#endif
+    return -1;
+}
+
+static bool copyTree(QString const& from, QString const& to) {
+    if (!QDir{}.mkpath(to)) {
+        return false;
+    }
+    auto entries = QDir { from }.entryInfoList(QDir::Files | QDir::Dirs |
+        QDir::NoDotAndDotDot);
+    for (auto &info : entries) {
+        auto target = to + "/" + info.fileName();
+        bool copied = info.isDir() ?
+            copyTree(info.absoluteFilePath(), target) :
+            QFile::copy(info.absoluteFilePath(), target);
+        if (!copied) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copies every .mascot folder in the library into the mascots folder the
+// manager loads from. Folders that are already there are left alone, so
+// their modification times and the frame cache stay valid between runs.
+// Returns the number of templates in the library, or -1 on failure.
+static int installLibrary(QString const& library) {
+    auto mascots = QDir::cleanPath(QStandardPaths::writableLocation(
+        QStandardPaths::AppLocalDataLocation) + "/mascots");
+    auto entries = QDir { library }.entryInfoList({ "*.mascot" },
+        QDir::Dirs | QDir::NoDotAndDotDot);
+    for (auto &info : entries) {
+        auto target = mascots + "/" + info.fileName();
+        if (!QFileInfo::exists(target) &&
+            !copyTree(info.absoluteFilePath(), target))
+        {
+            std::cerr << "Could not install " << info.fileName().toStdString()
+                << std::endl;
+            return -1;
+        }
+    }
+    return (int)entries.size();
+}
+
+// User and system CPU time of the process in seconds, or -1 if unknown
+static double cpuSeconds() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+            (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+#endif
+    return -1.0;
+}
+
+static void printPhases(TickProfiler const& profiler) {
+    qint64 ticks = std::max(profiler.ticks(), (qint64)1);
+    std::printf("%-16s %12s %10s %10s %10s %10s %10s\n", "phase", "total ms",
+        "us/tick", "p50 us", "p95 us", "p99 us", "max us");
+    for (int i=0; i<TickProfiler::PhaseCount; ++i) {
+        auto phase = (TickProfiler::Phase)i;
+        qint64 total = profiler.totalNsecs(phase);
+        auto stats = profiler.statistics(phase);
+        std::printf("%-16s %12.2f %10.2f %10.1f %10.1f %10.1f %10.1f\n",
+            TickProfiler::phaseName(phase), total / 1e6, total / 1e3 / ticks,
+            stats.p50, stats.p95, stats.p99, stats.max);
+    }
+}
+
+static void runHitTests(ShijimaManager *manager, int count) {
+    if (count <= 0) {
+        return;
+    }
+    QRect area;
+    for (auto screen : QGuiApplication::screens()) {
+        area = area.united(screen->geometry());
+    }
+    if (area.isEmpty()) {
+        return;
+    }
+    auto rng = QRandomGenerator::global();
+    std::vector<QPoint> points;
+    points.reserve(count);
+    for (int i=0; i<count; ++i) {
+        points.push_back({ area.x() + rng->bounded(area.width()),
+            area.y() + rng->bounded(area.height()) });
+    }
+    int hits = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (auto &point : points) {
+        if (manager->hitTest(point) != nullptr) {
+            ++hits;
+        }
+    }
+    qint64 elapsed = timer.nsecsElapsed();
+    std::printf("Hit tests: %d in %.2f ms (%.1f ns/test, %d hits)\n",
+        count, elapsed / 1e6, (double)elapsed / count, hits);
+
+    // What hitTest() did before the spatial index: ask every mascot in
+    // turn. Stands in for the old code, whose per-mascot test is gone.
+    int linearHits = 0;
+    timer.restart();
+    for (auto &point : points) {
+        for (auto mascot : manager->mascots()) {
+            if (mascot->pointInside(point - mascot->windowRect().topLeft())) {
+                ++linearHits;
+                break;
+            }
+        }
+    }
+    qint64 linearElapsed = timer.nsecsElapsed();
+    std::printf("Linear scan: %d in %.2f ms (%.1f ns/test, %d hits, "
+        "%.1fx slower)\n", count, linearElapsed / 1e6,
+        (double)linearElapsed / count, linearHits,
+        (double)linearElapsed / std::max(elapsed, (qint64)1));
+}
+
+static void runIdle(ShijimaManager *manager, int seconds) {
+    if (seconds <= 0) {
+        return;
+    }
+    // Paced to the screens like the app, not once per tick
+    double refreshRate = 0.0;
+    for (auto screen : QGuiApplication::screens()) {
+        refreshRate = std::max(refreshRate, (double)screen->refreshRate());
+    }
+    manager->repaintScheduler().setRefreshRate(refreshRate);
+    // The wakeup counter reports the last full second, so it is sampled
+    // once per second and averaged
+    double wakeups = 0.0;
+    int samples = 0;
+    QTimer sampler;
+    sampler.setInterval(1000);
+    QObject::connect(&sampler, &QTimer::timeout, [&]() {
+        wakeups += manager->timerWakeups().rate();
+        ++samples;
+    });
+    QEventLoop loop;
+    QTimer::singleShot(seconds * 1000, &loop, &QEventLoop::quit);
+    // Starts the window the mixer load is measured over, see printSounds()
+    SoundBank::defaultBank()->statistics();
+    double cpuStart = cpuSeconds();
+    QElapsedTimer timer;
+    timer.start();
+    sampler.start();
+    manager->wakeTicks();
+    loop.exec();
+    manager->stopTicks();
+    double wall = timer.nsecsElapsed() / 1e9;
+    double cpu = cpuSeconds() - cpuStart;
+    std::printf("Idle: %d mascots for %.1f s, %.1f%% CPU, "
+        "%.1f timer wakeups/s\n", (int)manager->mascots().size(), wall,
+        cpuStart >= 0 ? cpu / wall * 100.0 : -1.0,
+        samples > 0 ? wakeups / samples : 0.0);
+}
+
+// Mixer load is only meaningful after runIdle(), ticks driven by hand do
+// not play sounds in real time
+static void printSounds(bool idle) {
+    auto stats = SoundBank::defaultBank()->statistics();
+    std::printf("Sounds: %d samples, %.1f MB decoded, %lld voices stolen",
+        stats.samples, stats.decodedBytes / (1024.0 * 1024.0),
+        (long long)stats.stolenVoices);
+    if (idle) {
+        std::printf(", mixer %.2f%% of a core", stats.mixerLoad * 100.0);
+    }
+    std::printf("\n");
+}
+
+int main(int argc, char **argv) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QStandardPaths::setTestModeEnabled(true);
+    QApplication app(argc, argv);
+    eApp->init();
+    app.setApplicationName("NeurolingsCE");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless NeurolingsCE tick and paint benchmark");
+    parser.addHelpOption();
+    QCommandLineOption mascotsOption { "mascots",
+        "Number of mascots to spawn.", "count", "100" };
+    QCommandLineOption ticksOption { "ticks",
+        "Number of ticks to measure.", "count", "1000" };
+    QCommandLineOption warmupOption { "warmup",
+        "Ticks to run before measuring.", "count", "50" };
+    QCommandLineOption templateOption { "template",
+        "Mascot template to spawn.", "name", "Default Mascot" };
+    QCommandLineOption hitTestsOption { "hit-tests",
+        "Number of random hit tests to time after the ticks.", "count", "100000" };
+    QCommandLineOption pacedOption { "paced",
+        "Keep paints paced to the screen refresh rate instead of painting every tick." };
+    QCommandLineOption overlaysOption { "overlays",
+        "Composite mascots into per-screen overlays instead of one window each." };
+    QCommandLineOption threadsOption { "threads",
+        "Comma separated simulation thread counts to measure, "
+        "e.g. 1,2,4,8,16 for a scaling curve.", "list", "1" };
+    QCommandLineOption libraryOption { "library",
+        "Folder of .mascot templates to install and load before "
+        "measuring, e.g. a 50 template library.", "dir" };
+    QCommandLineOption coldOption { "cold",
+        "Delete the frame cache first, so every frame is decoded." };
+    QCommandLineOption noAtlasOption { "no-atlas",
+        "Keep every frame in an image of its own instead of packing "
+        "templates into atlases." };
+    QCommandLineOption idleOption { "idle",
+        "Seconds to let the mascot timer run on its own at the end, "
+        "reporting CPU usage and timer wakeups.", "seconds", "0" };
+    parser.addOptions({ mascotsOption, ticksOption, warmupOption,
+        templateOption, hitTestsOption, pacedOption, overlaysOption,
+        threadsOption, libraryOption, coldOption, noAtlasOption,
+        idleOption });
+    parser.process(app);
+
+    int mascotCount = parser.value(mascotsOption).toInt();
+    int tickCount = parser.value(ticksOption).toInt();
+    int warmupCount = parser.value(warmupOption).toInt();
+    int idleSeconds = parser.value(idleOption).toInt();
+    QString templateName = parser.value(templateOption);
+    // No mascots at all is only interesting for the idle timer
+    if (mascotCount < 0 || (mascotCount == 0 && idleSeconds <= 0) ||
+        tickCount <= 0)
+    {
+        std::cerr << "--mascots and --ticks must be positive" << std::endl;
+        return 1;
+    }
+    std::vector<int> threadCounts;
+    for (auto &value : parser.value(threadsOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok;
+        int threads = value.trimmed().toInt(&ok);
+        if (!ok || threads <= 0) {
+            std::cerr << "invalid thread count: " << value.toStdString() << std::endl;
+            return 1;
+        }
+        threadCounts.push_back(threads);
+    }
+    if (threadCounts.empty()) {
+        threadCounts.push_back(1);
+    }
+
+    if (parser.isSet(libraryOption)) {
+        int templates = installLibrary(parser.value(libraryOption));
+        if (templates < 0) {
+            return 1;
+        }
+        std::printf("Library: %d templates\n", templates);
+    }
+    if (parser.isSet(coldOption)) {
+        // Before the loader exists, it prunes the cache when created
+        QDir { QStandardPaths::writableLocation(
+            QStandardPaths::AppLocalDataLocation) + "/framecache" }
+            .removeRecursively();
+    }
+    // Has to be set before the manager loads the templates
+    AssetLoader::defaultLoader()->setAtlasEnabled(!parser.isSet(noAtlasOption));
+
+    int ret = 0;
+    {
+        QElapsedTimer loadTimer;
+        loadTimer.start();
+        ShijimaManager *manager = ShijimaManager::defaultManager();
+        AssetLoader::defaultLoader()->waitForBackgroundWork();
+        qint64 loadNsecs = loadTimer.nsecsElapsed();
+        // Delivers the preload results queued for the GUI thread
+        app.processEvents();
+        auto loaderStats = AssetLoader::defaultLoader()->statistics();
+        std::printf("Loaded: %d templates %s atlases in %.1f ms, "
+            "%d of %d frames from the frame cache\n",
+            (int)manager->loadedMascots().size(),
+            parser.isSet(noAtlasOption) ? "without" : "with",
+            loadNsecs / 1e6, loaderStats.diskCacheHits,
+            loaderStats.backgroundDecodes);
+        qint64 loadedRss = residentSize();
+        if (loadedRss >= 0) {
+            std::printf("RSS after loading: %.1f MB\n",
+                loadedRss / (1024.0 * 1024.0));
+        }
+        // The benchmark drives ticks itself
+        manager->stopTicks();
+        if (!manager->loadedMascots().contains(templateName)) {
+            std::cerr << "Unknown mascot template: "
+                << templateName.toStdString() << std::endl;
+            ret = 1;
+        }
+        else {
+            // Set before spawning so no window has to be recycled. The
+            // user's own choice is put back afterwards.
+            bool savedOverlays = manager->overlayRendering();
+            manager->setOverlayRendering(parser.isSet(overlaysOption));
+            std::printf("Rendering: %s\n", manager->usesOverlays() ?
+                "overlays" : "windows");
+            if (!parser.isSet(pacedOption)) {
+                // Every tick gets a display frame
+                manager->repaintScheduler().setRefreshRate(1e9);
+            }
+            // Mascots are spread over as many lanes as there are threads
+            // when they spawn, so spawn them with the largest count
+            manager->setSimulationThreads(*std::max_element(
+                threadCounts.begin(), threadCounts.end()));
+            for (int i=0; i<mascotCount; ++i) {
+                manager->spawn(templateName.toStdString());
+            }
+            // Spawning restarts the timer
+            manager->stopTicks();
+            app.processEvents();
+            std::printf("Mascots: %d spawned\n", mascotCount);
+            std::vector<std::pair<int, double>> curve;
+            for (int requested : threadCounts) {
+                manager->setSimulationThreads(requested);
+                // The thread count that was actually applied
+                int threads = manager->simulationThreads();
+                for (int i=0; i<warmupCount; ++i) {
+                    manager->tick();
+                    app.processEvents();
+                }
+
+                auto &profiler = manager->tickProfiler();
+                profiler.reset();
+                profiler.setEnabled(true);
+                QElapsedTimer timer;
+                timer.start();
+                for (int i=0; i<tickCount; ++i) {
+                    manager->tick();
+                    // Paints posted by the tick are delivered here
+                    app.processEvents();
+                }
+                qint64 elapsed = timer.nsecsElapsed();
+
+                double ticksPerSecond = tickCount * 1e9 / elapsed;
+                curve.push_back({ threads, ticksPerSecond });
+                std::printf("\nThreads: %d, %d mascots alive\n", threads,
+                    (int)manager->mascots().size());
+                std::printf("Ticks: %d in %.2f ms (%.1f ticks/s)\n", tickCount,
+                    elapsed / 1e6, ticksPerSecond);
+                printPhases(profiler);
+                profiler.setEnabled(false);
+            }
+            if (curve.size() > 1) {
+                std::printf("\n%-8s %12s %8s\n", "threads", "ticks/s", "speedup");
+                for (auto &point : curve) {
+                    std::printf("%-8d %12.1f %7.2fx\n", point.first, point.second,
+                        point.second / curve.front().second);
+                }
+            }
+            runHitTests(manager, parser.value(hitTestsOption).toInt());
+            runIdle(manager, idleSeconds);
+            printSounds(idleSeconds > 0);
+            SettingsStore::defaultStore()->setValue("overlayRendering",
+                QVariant::fromValue(savedOverlays));
+        }
+    }
+    qint64 peakRss = peakResidentSize();
+    if (peakRss >= 0) {
+        std::printf("Peak RSS: %.1f MB\n", peakRss / (1024.0 * 1024.0));
+    }
+    else {
+        std::printf("Peak RSS: unknown\n");
+    }
+    std::fflush(stdout);
+    ShijimaManager::finalize();
+    AssetLoader::finalize();
+    SoundBank::finalize();
+    SettingsStore::finalize();
+    return ret;
+}
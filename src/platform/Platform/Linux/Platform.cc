@@ -26,6 +26,7 @@
 #endif
 #include "../Platform.hpp"
 #include <stdlib.h>
+#include <stdio.h>
 #include <QWidget>
 #include <QApplication>
 #include <X11/Xlib.h>
@@ -162,4 +163,26 @@ bool useWindowMasks() {
     return windowMasksEnabled;
 }
 
+void flushWindowSystem() {
+    auto x11App = qApp->nativeInterface<QNativeInterface::QX11Application>();
+    if (x11App != nullptr && x11App->display() != nullptr) {
+        XFlush(x11App->display());
+    }
+}
+
+long long residentSetSize() {
+    // Second field of statm is the resident set in pages
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr) {
+        return -1;
+    }
+    long long size, resident;
+    int matched = fscanf(statm, "%lld %lld", &size, &resident);
+    fclose(statm);
+    if (matched != 2) {
+        return -1;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
 }
\ No newline at end of file
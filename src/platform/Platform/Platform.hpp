@@ -28,5 +28,10 @@ namespace Platform {
 void initialize(int argc, char **argv);
 void showOnAllDesktops(QWidget *widget);
 bool useWindowMasks();
+// Sends buffered requests to the window system. Called once per tick so
+// that geometry and shape changes of all mascots go out together.
+void flushWindowSystem();
+// Resident memory of this process in bytes, -1 if unknown
+long long residentSetSize();
 
 }
@@ -25,5 +25,9 @@ void showOnAllDesktops(QWidget *widget) {}
 bool useWindowMasks() {
     return false;
 }
+void flushWindowSystem() {}
+long long residentSetSize() {
+    return -1;
+}
 
 }
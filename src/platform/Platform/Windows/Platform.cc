@@ -19,6 +19,7 @@
 #include "../Platform.hpp"
 #include <QWidget>
 #include <windows.h>
+#include <psapi.h>
 
 namespace Platform {
 
@@ -40,4 +41,16 @@ bool useWindowMasks() {
     return false;
 }
 
+void flushWindowSystem() {}
+
+long long residentSetSize() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+        sizeof(counters)))
+    {
+        return -1;
+    }
+    return (long long)counters.WorkingSetSize;
+}
+
 }
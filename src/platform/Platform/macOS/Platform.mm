@@ -19,6 +19,7 @@
 #include "../Platform.hpp"
 #include <QWidget>
 #include <AppKit/AppKit.h>
+#include <mach/mach.h>
 
 namespace Platform {
 
@@ -36,4 +37,17 @@ bool useWindowMasks() {
     return false;
 }
 
+void flushWindowSystem() {}
+
+long long residentSetSize() {
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+        (task_info_t)&info, &count) != KERN_SUCCESS)
+    {
+        return -1;
+    }
+    return (long long)info.resident_size;
+}
+
 }
@@ -0,0 +1,215 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+// Checks the vector alpha bounds scans against the scalar one, and both
+// against a copy of the pixelColor() loop they replaced. Plain C++ without
+// Qt, run with ctest when NEUROLINGSCE_BUILD_TESTS is on.
+
+#include "shijima-qt/AlphaBounds.hpp"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+// Rows are stride pixels apart. One extra leading pixel lets the image
+// start off the natural vector alignment.
+struct Image {
+    int width, height, stride;
+    std::vector<uint32_t> storage;
+    Image(int width, int height, int stride): width(width), height(height),
+        stride(stride), storage((size_t)stride * height + 1, 0) {}
+    uint32_t *row(int y) { return storage.data() + 1 + (size_t)y * stride; }
+    const unsigned char *bits() {
+        return reinterpret_cast<const unsigned char *>(row(0));
+    }
+};
+
+// The loop Asset::getRectForImage() used before AlphaBounds, unchanged
+// except that pixelColor(x, y).alpha() reads the alpha byte directly
+AlphaBounds::Rect referenceBounds(Image &image) {
+    auto alpha = [&image](int x, int y) {
+        return (int)(image.row(y)[x] >> 24);
+    };
+    int startX=0, endX=image.width, startY=0, endY=image.height;
+    int x, y;
+
+    for (x=0; x<endX; ++x) {
+        for (y=0; y<endY; ++y) {
+            if (alpha(x, y) > 0) break;
+        }
+        if (y != endY) break;
+    }
+    startX = x;
+
+    for (y=0; y<endY; ++y) {
+        for (x=startX; x<endX; ++x) {
+            if (alpha(x, y) > 0) break;
+        }
+        if (x != endX) break;
+    }
+    startY = y;
+
+    for (x=endX-1; x>startX; --x) {
+        for (y=startY; y<endY; ++y) {
+            if (alpha(x, y) > 0) break;
+        }
+        if (y != endY) break;
+    }
+    endX = x+1;
+
+    for (y=endY-1; y>startY; --y) {
+        for (x=startX; x<endX; ++x) {
+            if (alpha(x, y) > 0) break;
+        }
+        if (x != endX) break;
+    }
+    endY = y+1;
+
+    return { startX, startY, endX - startX, endY - startY };
+}
+
+void compareBounds(Image &image, const char *what, const char *name,
+    AlphaBounds::Rect bounds, const char *expectedName,
+    AlphaBounds::Rect expected)
+{
+    if (bounds.x != expected.x || bounds.y != expected.y ||
+        bounds.width != expected.width || bounds.height != expected.height)
+    {
+        std::printf("%s: %dx%d stride %d %s bounds (%d, %d, %d, %d), "
+            "%s (%d, %d, %d, %d)\n", what, image.width, image.height,
+            image.stride, name, bounds.x, bounds.y, bounds.width,
+            bounds.height, expectedName, expected.x, expected.y,
+            expected.width, expected.height);
+        ++failures;
+    }
+}
+
+void check(Image &image, const char *what) {
+    using namespace AlphaBounds;
+    for (int y=0; y<image.height; ++y) {
+        auto row = image.row(y);
+        for (int begin=0; begin<=image.width; ++begin) {
+            int first = firstOpaque<VectorGroup>(row, begin, image.width);
+            int expected = firstOpaque<ScalarGroup>(row, begin, image.width);
+            if (first != expected) {
+                std::printf("%s: firstOpaque(row %d, %d, %d) = %d, "
+                    "expected %d\n", what, y, begin, image.width, first,
+                    expected);
+                ++failures;
+            }
+            int last = lastOpaque<VectorGroup>(row, begin, image.width);
+            expected = lastOpaque<ScalarGroup>(row, begin, image.width);
+            if (last != expected) {
+                std::printf("%s: lastOpaque(row %d, %d, %d) = %d, "
+                    "expected %d\n", what, y, begin, image.width, last,
+                    expected);
+                ++failures;
+            }
+        }
+    }
+    auto stride = (std::ptrdiff_t)image.stride * sizeof(uint32_t);
+    auto vector = opaqueBounds<VectorGroup>(image.bits(), image.width,
+        image.height, stride);
+    auto scalar = opaqueBounds<ScalarGroup>(image.bits(), image.width,
+        image.height, stride);
+    auto reference = referenceBounds(image);
+    compareBounds(image, what, "vector", vector, "scalar", scalar);
+    compareBounds(image, what, "vector", vector, "reference", reference);
+    compareBounds(image, what, "scalar", scalar, "reference", reference);
+}
+
+void checkBounds(Image &image, AlphaBounds::Rect expected, const char *what) {
+    auto bounds = AlphaBounds::opaqueBounds(image.bits(), image.width,
+        image.height, (std::ptrdiff_t)image.stride * sizeof(uint32_t));
+    if (bounds.x != expected.x || bounds.y != expected.y ||
+        bounds.width != expected.width || bounds.height != expected.height)
+    {
+        std::printf("%s: %dx%d bounds (%d, %d, %d, %d), expected "
+            "(%d, %d, %d, %d)\n", what, image.width, image.height, bounds.x,
+            bounds.y, bounds.width, bounds.height, expected.x, expected.y,
+            expected.width, expected.height);
+        ++failures;
+    }
+}
+
+}
+
+int main() {
+    std::mt19937 random { 12345 };
+    // Widths around and between the 4 and 8 pixel vector groups, strides
+    // that are and are not a multiple of them
+    const int widths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 13, 16, 17, 31, 33, 64 };
+    const int paddings[] = { 0, 1, 3, 5 };
+    for (int width : widths) {
+        for (int padding : paddings) {
+            int height = 1 + (int)(random() % 6);
+            int stride = width + padding;
+
+            Image transparent { width, height, stride };
+            // Padding between rows must never count as part of a row
+            for (int y=0; y<height; ++y) {
+                for (int x=width; x<stride; ++x) {
+                    transparent.row(y)[x] = 0xFF000000;
+                }
+            }
+            check(transparent, "transparent");
+            checkBounds(transparent, { width, height, 0, 0 }, "transparent");
+
+            const int corners[][2] = { { 0, 0 }, { width - 1, 0 },
+                { 0, height - 1 }, { width - 1, height - 1 } };
+            for (auto &corner : corners) {
+                Image single { width, height, stride };
+                // Colour without alpha must still read as transparent
+                for (int y=0; y<height; ++y) {
+                    for (int x=0; x<width; ++x) {
+                        single.row(y)[x] = 0x00FFFFFF;
+                    }
+                }
+                single.row(corner[1])[corner[0]] = 0x01000000;
+                check(single, "corner");
+                checkBounds(single, { corner[0], corner[1], 1, 1 }, "corner");
+            }
+
+            for (int density : { 2, 10, 50 }) {
+                Image noise { width, height, stride };
+                for (int y=0; y<height; ++y) {
+                    for (int x=0; x<stride; ++x) {
+                        uint32_t pixel = (uint32_t)random() & 0x00FFFFFF;
+                        if ((int)(random() % 100) < density) {
+                            pixel |= ((uint32_t)random() % 255 + 1) << 24;
+                        }
+                        noise.row(y)[x] = pixel;
+                    }
+                }
+                check(noise, "random");
+            }
+        }
+    }
+    if (failures != 0) {
+        std::printf("%d mismatches\n", failures);
+        return 1;
+    }
+    std::printf("Vector group of %d pixels matches the scalar scan and "
+        "the reference loop\n",
+        AlphaBounds::VectorGroup::kSize);
+    return 0;
+}
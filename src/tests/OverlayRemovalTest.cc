@@ -0,0 +1,97 @@
+// 
+// Shijima-Qt - Cross-platform shimeji simulation app for desktop
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+// Checks that overlays drop a mascot that is removed on a tick without a
+// display frame. Ticks stop once no mascot is left, so an overlay that
+// waited for the next frame would keep showing it. Runs under the
+// offscreen QPA platform, see the bench for the same setup.
+
+#include <QApplication>
+#include <QStandardPaths>
+#include <cstdio>
+#include "shijima-qt/ShijimaManager.hpp"
+#include "shijima-qt/AssetLoader.hpp"
+#include "shijima-qt/MascotOverlay.hpp"
+#include "shijima-qt/SettingsStore.hpp"
+#include "shijima-qt/SoundBank.hpp"
+#include "ElaApplication.h"
+
+static int run(ShijimaManager *manager) {
+    manager->stopTicks();
+    manager->setOverlayRendering(true);
+    if (!manager->usesOverlays()) {
+        std::printf("Overlay rendering could not be enabled\n");
+        return 1;
+    }
+    // One frame per second at most, so only the first tick below gets one
+    manager->repaintScheduler().setRefreshRate(1.0);
+    ShijimaWidget *mascot = manager->spawn("Default Mascot");
+    manager->stopTicks();
+    manager->tick();
+    QApplication::processEvents();
+
+    QRect rect = mascot->windowRect();
+    MascotOverlay *overlay = nullptr;
+    for (auto widget : QApplication::topLevelWidgets()) {
+        auto candidate = dynamic_cast<MascotOverlay *>(widget);
+        if (candidate != nullptr && candidate->geometry().intersects(rect)) {
+            overlay = candidate;
+        }
+    }
+    if (overlay == nullptr) {
+        std::printf("No overlay shows the mascot at (%d, %d)\n", rect.x(),
+            rect.y());
+        return 1;
+    }
+    auto local = rect.translated(-overlay->pos());
+    if (!overlay->mask().intersects(local)) {
+        std::printf("The overlay does not take input for the mascot\n");
+        return 1;
+    }
+
+    mascot->close();
+    manager->tick();
+    QApplication::processEvents();
+    if (manager->mascots().size() != 0) {
+        std::printf("The closed mascot was not removed\n");
+        return 1;
+    }
+    if (overlay->mask().intersects(local)) {
+        std::printf("The overlay still shows the removed mascot\n");
+        return 1;
+    }
+    std::printf("Removed mascot left the overlay without a display frame\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QStandardPaths::setTestModeEnabled(true);
+    QApplication app(argc, argv);
+    eApp->init();
+    app.setApplicationName("NeurolingsCE-tests");
+    int ret = run(ShijimaManager::defaultManager());
+    ShijimaManager::finalize();
+    AssetLoader::finalize();
+    SoundBank::finalize();
+    SettingsStore::finalize();
+    return ret;
+}
@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+
+# Runs every benchmark configuration the performance changes are measured
+# with and prints the results one after another. Needs a build configured
+# with -DNEUROLINGSCE_BUILD_BENCH=ON. Each run is a separate process, so
+# the peak RSS it reports belongs to that configuration alone.
+
+# Fail on error
+set -e
+
+if [ -z "$1" ]; then
+    echo "Usage: $0 <path to neurolingsce_bench> [folder of .mascot templates]" >&2
+    exit 1
+fi
+
+bench="$1"
+library="$2"
+
+run() {
+    echo "\$ neurolingsce_bench $*"
+    "${bench}" "$@"
+    echo
+}
+
+echo "# Windows vs. overlays"
+for mascots in 50 500 2000; do
+    run --mascots "${mascots}" --ticks 2000 --hit-tests 0
+    run --mascots "${mascots}" --ticks 2000 --hit-tests 0 --overlays
+done
+
+echo "# Simulation thread scaling ($(getconf _NPROCESSORS_ONLN) cores)"
+run --mascots 500 --ticks 2000 --hit-tests 0 --threads 1,2,4,8,16
+
+echo "# Hit testing"
+run --mascots 1000 --ticks 100 --hit-tests 100000
+
+echo "# Idle desktop"
+run --mascots 0 --ticks 1 --hit-tests 0 --idle 30
+run --mascots 20 --ticks 1 --hit-tests 0 --idle 30
+
+echo "# Sound bank"
+run --mascots 200 --ticks 1 --hit-tests 0 --idle 30
+
+if [ -n "${library}" ]; then
+    echo "# Template library memory"
+    run --library "${library}" --mascots 1 --ticks 1 --hit-tests 0 --no-atlas
+    run --library "${library}" --mascots 1 --ticks 1 --hit-tests 0
+
+    echo "# Cold and warm start"
+    run --library "${library}" --mascots 1 --ticks 1 --hit-tests 0 --cold
+    run --library "${library}" --mascots 1 --ticks 1 --hit-tests 0
+fi
@@ -37,6 +37,14 @@
         <source>  Mascots: %1  |  Templates: %2</source>
         <translation>  当前桌宠数量: %1  |  桌宠模板数: %2</translation>
     </message>
+    <message>
+        <source>  |  Mascot cap: %1  |  Breed queue: %2 (denied %3)</source>
+        <translation>  |  桌宠上限: %1  |  繁殖队列: %2 (已拒绝 %3)</translation>
+    </message>
+    <message>
+        <source>none</source>
+        <translation>无</translation>
+    </message>
     <!-- Home page -->
     <message>
         <source>Home</source>
@@ -115,6 +123,50 @@
         <source>Speech Bubble Click Count</source>
         <translation>气泡触发点击次数</translation>
     </message>
+    <message>
+        <source>Draw All Mascots in One Window per Screen</source>
+        <translation>每个屏幕使用单个窗口绘制所有桌宠</translation>
+    </message>
+    <message>
+        <source>Spare Mascot Windows</source>
+        <translation>备用桌宠窗口数</translation>
+    </message>
+    <message>
+        <source>Simultaneous Sounds</source>
+        <translation>同时播放的音效数</translation>
+    </message>
+    <message>
+        <source>Breeding Frame Budget (ms)</source>
+        <translation>繁殖帧预算 (毫秒)</translation>
+    </message>
+    <message>
+        <source>Maximum Mascots from Breeding</source>
+        <translation>繁殖桌宠数量上限</translation>
+    </message>
+    <message>
+        <source>Breeding Memory Cap (MB)</source>
+        <translation>繁殖内存上限 (MB)</translation>
+    </message>
+    <message>
+        <source>Off</source>
+        <translation>关闭</translation>
+    </message>
+    <message>
+        <source>Subticks per Tick</source>
+        <translation>每 tick 子步数</translation>
+    </message>
+    <message>
+        <source>Simulation Threads</source>
+        <translation>模拟线程数</translation>
+    </message>
+    <message>
+        <source>Profile Tick Phases</source>
+        <translation>统计 Tick 各阶段耗时</translation>
+    </message>
+    <message>
+        <source>Frame Cache Budget (MB)</source>
+        <translation>帧缓存上限 (MB)</translation>
+    </message>
     <!-- About page -->
     <message>
         <source>About</source>